@@ -86,7 +86,7 @@ static void reset_channel(struct channel *);
 static bool check_device_type(struct disk *);
 static void identify_ata_device(struct disk *);
 
-static void select_sector(struct disk *, disk_sector_t);
+static void select_sectors(struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -238,7 +238,7 @@ void disk_read(struct disk *d, disk_sector_t sec_no, void *buffer)
 
 	c = d->channel;
 	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
+	select_sectors(d, sec_no, 1);
 	issue_pio_command(c, CMD_READ_SECTOR_RETRY);
 	sema_down(&c->completion_wait);
 	if (!wait_while_busy(d))
@@ -262,7 +262,7 @@ void disk_write(struct disk *d, disk_sector_t sec_no, const void *buffer)
 
 	c = d->channel;
 	lock_acquire(&c->lock);
-	select_sector(d, sec_no);
+	select_sectors(d, sec_no, 1);
 	issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy(d))
 		PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -272,6 +272,93 @@ void disk_write(struct disk *d, disk_sector_t sec_no, const void *buffer)
 	lock_release(&c->lock);
 }
 
+/* Reads CNT consecutive sectors starting at SEC_NO from disk D.
+   Sector SEC_NO + I is stored into BUFFERS[I], each of which
+   must have room for DISK_SECTOR_SIZE bytes.  The buffers need
+   not be contiguous, so the pages of a swap cluster can be read
+   in place.
+
+   Up to DISK_MAX_XFER sectors are moved by a single READ SECTORS
+   command, which saves a command round trip and a seek per
+   sector compared to calling disk_read() in a loop.  The drive
+   interrupts once for each sector that becomes ready. */
+/* 디스크 D의 SEC_NO부터 연속된 CNT개의 섹터를 읽어 섹터
+   SEC_NO + I를 BUFFERS[I]에 저장합니다. 한 번의 명령으로 최대
+   DISK_MAX_XFER개의 섹터를 전송합니다. */
+void disk_read_sectors(struct disk *d, disk_sector_t sec_no, size_t cnt,
+					   void *const buffers[])
+{
+	struct channel *c;
+
+	ASSERT(d != NULL);
+	ASSERT(buffers != NULL);
+
+	c = d->channel;
+	lock_acquire(&c->lock);
+	while (cnt > 0)
+	{
+		size_t xfer = cnt < DISK_MAX_XFER ? cnt : DISK_MAX_XFER;
+		size_t i;
+
+		select_sectors(d, sec_no, xfer);
+		issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+		for (i = 0; i < xfer; i++)
+		{
+			sema_down(&c->completion_wait);
+			if (!wait_while_busy(d))
+				PANIC("%s: disk read failed, sector=%" PRDSNu,
+					  d->name, sec_no + (disk_sector_t)i);
+			input_sector(c, buffers[i]);
+		}
+		d->read_cnt += xfer;
+		sec_no += xfer;
+		buffers += xfer;
+		cnt -= xfer;
+	}
+	lock_release(&c->lock);
+}
+
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D,
+   taking sector SEC_NO + I from BUFFERS[I].  Returns after the
+   disk has acknowledged receiving all of the data.  Like
+   disk_read_sectors(), moves up to DISK_MAX_XFER sectors per
+   WRITE SECTORS command. */
+/* 디스크 D의 SEC_NO부터 연속된 CNT개의 섹터에 BUFFERS[I]의
+   내용을 씁니다. 디스크가 모든 데이터를 받았음을 확인한 후
+   반환합니다. */
+void disk_write_sectors(struct disk *d, disk_sector_t sec_no, size_t cnt,
+						const void *const buffers[])
+{
+	struct channel *c;
+
+	ASSERT(d != NULL);
+	ASSERT(buffers != NULL);
+
+	c = d->channel;
+	lock_acquire(&c->lock);
+	while (cnt > 0)
+	{
+		size_t xfer = cnt < DISK_MAX_XFER ? cnt : DISK_MAX_XFER;
+		size_t i;
+
+		select_sectors(d, sec_no, xfer);
+		issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+		for (i = 0; i < xfer; i++)
+		{
+			if (!wait_while_busy(d))
+				PANIC("%s: disk write failed, sector=%" PRDSNu,
+					  d->name, sec_no + (disk_sector_t)i);
+			output_sector(c, buffers[i]);
+			sema_down(&c->completion_wait);
+		}
+		d->write_cnt += xfer;
+		sec_no += xfer;
+		buffers += xfer;
+		cnt -= xfer;
+	}
+	lock_release(&c->lock);
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string(char *string, size_t size);
@@ -434,19 +521,22 @@ print_ata_string(char *string, size_t size)
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the transfer length CNT, which must be
+   between 1 and DISK_MAX_XFER, to the disk's sector selection
+   registers.  (We use LBA mode.) */
 /* 장치 D를 선택하고 준비가 될 때까지 기다린 다음 디스크의
-   섹터 선택 레지스터에 SEC_NO를 씁니다. (LBA 모드를 사용합니다.) */
-static void select_sector(struct disk *d, disk_sector_t sec_no)
+   섹터 선택 레지스터에 SEC_NO와 전송 길이 CNT를 씁니다.
+   (LBA 모드를 사용합니다.) */
+static void select_sectors(struct disk *d, disk_sector_t sec_no, size_t cnt)
 {
 	struct channel *c = d->channel;
 
-	ASSERT(sec_no < d->capacity);
-	ASSERT(sec_no < (1UL << 28));
+	ASSERT(cnt > 0 && cnt <= DISK_MAX_XFER);
+	ASSERT(sec_no + cnt <= d->capacity);
+	ASSERT(sec_no + cnt <= (1UL << 28));
 
 	select_device_wait(d);
-	outb(reg_nsect(c), 1);
+	outb(reg_nsect(c), (uint8_t)cnt); /* 0 means 256 sectors. */
 	outb(reg_lbal(c), sec_no);
 	outb(reg_lbam(c), sec_no >> 8);
 	outb(reg_lbah(c), (sec_no >> 16));
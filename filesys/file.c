@@ -2,6 +2,11 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Pages in the kernel buffer used by file_copy(). */
+#define FILE_COPY_PAGES 4
 
 /* An open file. */
 /* 열린 파일입니다. */
@@ -154,6 +159,51 @@ off_t file_write_at(struct file *file, const void *buffer, off_t size,
 	return inode_write_at(file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+ * position, into DST, starting at its current position, and
+ * advances both positions by the number of bytes copied.
+ * The data moves through a kernel buffer of FILE_COPY_PAGES
+ * pages, so that each chunk costs one disk command to read and
+ * one to write when the sectors are consecutive.  Returns the
+ * number of bytes copied, which may be less than SIZE if end of
+ * SRC or DST is reached or no buffer can be allocated. */
+/* SRC의 현재 위치부터 최대 SIZE 바이트를 DST의 현재 위치로 복사하고
+ * 두 파일의 위치를 복사한 바이트 수만큼 전진시킵니다.
+ * 복사한 바이트 수를 반환합니다. */
+off_t file_copy(struct file *dst, struct file *src, off_t size)
+{
+	size_t page_cnt = FILE_COPY_PAGES;
+	off_t bytes_copied = 0;
+	uint8_t *buffer = palloc_get_multiple(0, page_cnt);
+
+	if (buffer == NULL)
+	{
+		page_cnt = 1;
+		buffer = palloc_get_page(0);
+		if (buffer == NULL)
+			return 0;
+	}
+
+	while (size > 0)
+	{
+		off_t chunk_size = size < (off_t)(page_cnt * PGSIZE)
+							   ? size
+							   : (off_t)(page_cnt * PGSIZE);
+		off_t read = inode_read_at(src->inode, buffer, chunk_size, src->pos);
+		off_t written = inode_write_at(dst->inode, buffer, read, dst->pos);
+
+		src->pos += written;
+		dst->pos += written;
+		bytes_copied += written;
+		size -= written;
+		if (written < chunk_size)
+			break;
+	}
+	palloc_free_multiple(buffer, page_cnt);
+
+	return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 /* file_allow_write()가 호출되거나 FILE이 닫힐 때까지
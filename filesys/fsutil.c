@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,18 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Sectors in the page-sized buffer that fsutil_put() and
+   fsutil_get() move between the scratch disk and a file with
+   one disk command at a time. */
+#define XFER_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Points SECTORS[] at the XFER_SECTORS sectors of BUFFER. */
+static void
+buffer_sectors (void *sectors[], void *buffer) {
+	for (size_t i = 0; i < XFER_SECTORS; i++)
+		sectors[i] = (uint8_t *) buffer + i * DISK_SECTOR_SIZE;
+}
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) {
@@ -83,13 +96,15 @@ fsutil_put (char **argv) {
 	struct file *dst;
 	off_t size;
 	void *buffer;
+	void *sectors[XFER_SECTORS];
 
 	printf ("Putting '%s' into the file system...\n", file_name);
 
 	/* Allocate buffer. */
-	buffer = malloc (DISK_SECTOR_SIZE);
+	buffer = palloc_get_page (0);
 	if (buffer == NULL)
 		PANIC ("couldn't allocate buffer");
+	buffer_sectors (sectors, buffer);
 
 	/* Open source disk and read file size. */
 	src = disk_get (1, 0);
@@ -113,8 +128,10 @@ fsutil_put (char **argv) {
 
 	/* Do copy. */
 	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		disk_read (src, sector++, buffer);
+		int chunk_size = size > PGSIZE ? PGSIZE : size;
+		size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+		disk_read_sectors (src, sector, sector_cnt, sectors);
+		sector += sector_cnt;
 		if (file_write (dst, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: write failed with %"PROTd" bytes unwritten",
 					file_name, size);
@@ -123,7 +140,7 @@ fsutil_put (char **argv) {
 
 	/* Finish up. */
 	file_close (dst);
-	free (buffer);
+	palloc_free_page (buffer);
 }
 
 /* Copies file FILE_NAME from the file system to the scratch disk.
@@ -146,13 +163,15 @@ fsutil_get (char **argv) {
 	struct file *src;
 	struct disk *dst;
 	off_t size;
+	void *sectors[XFER_SECTORS];
 
 	printf ("Getting '%s' from the file system...\n", file_name);
 
 	/* Allocate buffer. */
-	buffer = malloc (DISK_SECTOR_SIZE);
+	buffer = palloc_get_page (0);
 	if (buffer == NULL)
 		PANIC ("couldn't allocate buffer");
+	buffer_sectors (sectors, buffer);
 
 	/* Open source file. */
 	src = filesys_open (file_name);
@@ -173,17 +192,21 @@ fsutil_get (char **argv) {
 
 	/* Do copy. */
 	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		if (sector >= disk_size (dst))
+		int chunk_size = size > PGSIZE ? PGSIZE : size;
+		size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+		if (sector + sector_cnt > disk_size (dst))
 			PANIC ("%s: out of space on scratch disk", file_name);
 		if (file_read (src, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-		memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-		disk_write (dst, sector++, buffer);
+		memset (buffer + chunk_size, 0,
+				sector_cnt * DISK_SECTOR_SIZE - chunk_size);
+		disk_write_sectors (dst, sector, sector_cnt,
+				(const void *const *) sectors);
+		sector += sector_cnt;
 		size -= chunk_size;
 	}
 
 	/* Finish up. */
 	file_close (src);
-	free (buffer);
+	palloc_free_page (buffer);
 }
@@ -10,6 +10,10 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Most whole sectors moved by a single disk command in
+ * inode_read_at() and inode_write_at(). */
+#define INODE_RUN_MAX 32
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk
@@ -54,6 +58,31 @@ static disk_sector_t byte_to_sector(const struct inode *inode, off_t pos)
 		return -1;
 }
 
+/* Returns the number of whole sectors, at most INODE_RUN_MAX,
+ * that start at sector-aligned OFFSET within INODE, lie within
+ * the first SIZE bytes from OFFSET and within INODE, and are
+ * consecutive on disk.  Such a run can be moved by one disk
+ * command instead of one command per sector. */
+/* OFFSET부터 시작하여 SIZE 바이트와 INODE 안에 들어가고 디스크에서
+ * 연속된 전체 섹터의 개수(최대 INODE_RUN_MAX)를 반환합니다. */
+static size_t sector_run(const struct inode *inode, off_t offset, off_t size)
+{
+	disk_sector_t first = byte_to_sector(inode, offset);
+	size_t cnt = 1;
+
+	while (cnt < INODE_RUN_MAX)
+	{
+		off_t next = offset + (off_t)cnt * DISK_SECTOR_SIZE;
+
+		if (next - offset + DISK_SECTOR_SIZE > size ||
+			next + DISK_SECTOR_SIZE > inode_length(inode) ||
+			byte_to_sector(inode, next) != first + cnt)
+			break;
+		cnt++;
+	}
+	return cnt;
+}
+
 /* List of open inodes, so that opening a single inode twice
  * returns the same `struct inode'. */
 static struct list open_inodes;
@@ -235,9 +264,17 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
 		{
-			/* Read full sector directly into caller's buffer. */
-			/* 전체 섹터를 호출자의 버퍼로 직접 읽습니다. */
-			disk_read(filesys_disk, sector_idx, buffer + bytes_read);
+			/* Read full sectors directly into caller's buffer,
+			 * as many consecutive ones as one command can take. */
+			/* 전체 섹터를 호출자의 버퍼로 직접 읽습니다. 연속된 섹터는
+			 * 한 번의 명령으로 읽습니다. */
+			size_t cnt = sector_run(inode, offset, size);
+			void *sectors[INODE_RUN_MAX];
+
+			for (size_t i = 0; i < cnt; i++)
+				sectors[i] = buffer + bytes_read + i * DISK_SECTOR_SIZE;
+			disk_read_sectors(filesys_disk, sector_idx, cnt, sectors);
+			chunk_size = cnt * DISK_SECTOR_SIZE;
 		}
 		else
 		{
@@ -299,8 +336,15 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
 		{
-			/* Write full sector directly to disk. */
-			disk_write(filesys_disk, sector_idx, buffer + bytes_written);
+			/* Write full sectors directly to disk, as many
+			   consecutive ones as one command can take. */
+			size_t cnt = sector_run(inode, offset, size);
+			const void *sectors[INODE_RUN_MAX];
+
+			for (size_t i = 0; i < cnt; i++)
+				sectors[i] = buffer + bytes_written + i * DISK_SECTOR_SIZE;
+			disk_write_sectors(filesys_disk, sector_idx, cnt, sectors);
+			chunk_size = cnt * DISK_SECTOR_SIZE;
 		}
 		else
 		{
@@ -131,4 +131,42 @@ __attribute__((always_inline)) static __inline void write_msr(uint32_t ecx, uint
 	__asm __volatile("wrmsr" ::"c"(ecx), "d"(edx), "a"(eax));
 }
 
+__attribute__((always_inline)) static __inline uint64_t rcr4(void)
+{
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r"(val));
+	return val;
+}
+
+__attribute__((always_inline)) static __inline void lcr4(uint64_t val)
+{
+	__asm __volatile("movq %0, %%cr4" : : "r"(val) : "memory");
+}
+
+/* Executes CPUID for leaf LEAF, subleaf SUBLEAF. */
+/* 리프 LEAF, 서브리프 SUBLEAF에 대해 CPUID를 실행합니다. */
+__attribute__((always_inline)) static __inline void cpuid(uint32_t leaf, uint32_t subleaf,
+														  uint32_t *eax, uint32_t *ebx,
+														  uint32_t *ecx, uint32_t *edx)
+{
+	__asm __volatile("cpuid"
+					 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+					 : "a"(leaf), "c"(subleaf));
+}
+
+/* Invalidates TLB entries tagged with process-context identifier
+   PCID, as selected by TYPE (see the INVPCID_* constants).  VA is
+   only used for INVPCID_ADDR.  See [IA32-v2a] "INVPCID". */
+/* TYPE에 따라 PCID로 태그된 TLB 항목을 무효화합니다. */
+__attribute__((always_inline)) static __inline void invpcid(uint64_t type, uint64_t pcid,
+															uint64_t va)
+{
+	struct
+	{
+		uint64_t pcid;
+		uint64_t va;
+	} desc = {pcid, va};
+	__asm __volatile("invpcid %0, %1" : : "m"(desc), "r"(type) : "memory");
+}
+
 #endif /* intrinsic.h */
@@ -96,5 +96,59 @@ bool hash_empty (struct hash *);
 uint64_t hash_bytes (const void *, size_t);
 uint64_t hash_string (const char *);
 uint64_t hash_int (int);
+uint64_t hash_ptr (uintptr_t);
+
+/* Open-addressing hash table with pointer-sized keys.
+ *
+ * Where the table above chains elements through lists, this one
+ * stores each key and its value inline in an array of slots and
+ * resolves collisions by linear probing with robin-hood
+ * ordering: an entry being inserted displaces any entry that is
+ * closer to its home slot than the new one is to its own.  This
+ * keeps probe sequences short and lets a lookup for an absent
+ * key stop early, so most lookups touch a single cache line.
+ *
+ * When the table grows, the entries are not all moved at once.
+ * The old slot array is kept, and each later insertion or
+ * deletion migrates a few of its slots into the new array;
+ * lookups consult both arrays until the migration finishes.
+ *
+ * Keys are arbitrary uintptr_t values, such as addresses.
+ * Values must not be null pointers, since phash_find() uses a
+ * null pointer to report a missing key. */
+
+/* One slot of a phash table. */
+struct phash_slot {
+	uintptr_t key;              /* Key. */
+	void *value;                /* Value, or garbage if unused. */
+};
+
+/* A slot array and its occupancy. */
+struct phash_table {
+	size_t slot_cnt;            /* Number of slots, a power of 2, or 0. */
+	size_t elem_cnt;            /* Number of used slots. */
+	struct phash_slot *slots;   /* Array of `slot_cnt' slots. */
+	uint8_t *dist;              /* Per-slot probe distance plus 1, or 0
+	                               if the slot is unused. */
+};
+
+/* Open-addressing hash table. */
+struct phash {
+	struct phash_table cur;     /* Table receiving new entries. */
+	struct phash_table old;     /* Table being migrated from, if any. */
+	size_t migrate_pos;         /* Next slot of `old' to migrate. */
+};
+
+/* Performs some operation on the entry with KEY and VALUE, given
+ * auxiliary data AUX. */
+typedef void phash_action_func (uintptr_t key, void *value, void *aux);
+
+void phash_init (struct phash *);
+void phash_destroy (struct phash *, phash_action_func *, void *aux);
+bool phash_insert (struct phash *, uintptr_t key, void *value);
+void *phash_find (struct phash *, uintptr_t key);
+void *phash_delete (struct phash *, uintptr_t key);
+void phash_apply (struct phash *, phash_action_func *, void *aux);
+size_t phash_size (struct phash *);
 
 #endif /* lib/kernel/hash.h */
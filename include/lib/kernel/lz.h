@@ -0,0 +1,29 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77 block compression.
+ *
+ * The encoding is that of an LZ4 block: a sequence of runs, each
+ * a token byte holding a literal count and a match length, any
+ * extra length bytes, the literals, and a two-byte offset back to
+ * the start of the match.  The compressor finds matches with a
+ * single-entry hash table of 4-byte prefixes and does no lazy
+ * matching, which makes it fast rather than thorough: it is meant
+ * for compressing pages on the way to swap, where time matters
+ * more than the last few percent of ratio. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Largest input lz_compress() accepts. */
+#define LZ_MAX_INPUT 65536
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_WORK_SIZE 8192
+
+size_t lz_compress (const void *src, size_t src_size, void *dst,
+		size_t dst_cap, void *work);
+bool lz_decompress (const void *src, size_t src_size, void *dst,
+		size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
@@ -1,6 +1,8 @@
 #ifndef __LIB_SYSCALL_NR_H
 #define __LIB_SYSCALL_NR_H
 
+#include <stddef.h>
+
 /* System call numbers. */
 enum {
 	/* Projects 2 and later. */
@@ -36,6 +38,28 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+	SYS_SPAWN,                  /* Start a process running a program. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_PREAD,                  /* Read from a file at a given position. */
+	SYS_PWRITE,                 /* Write to a file at a given position. */
+	SYS_COPY_FILE_RANGE,        /* Copy data between two files. */
+};
+
+/* Flags for SYS_MSYNC. */
+#define MS_ASYNC 1              /* Schedule the write-back. */
+#define MS_SYNC 4               /* Write back before returning. */
+
+/* One buffer of a SYS_READV or SYS_WRITEV request. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Its length in bytes. */
 };
 
+/* Most buffers in one SYS_READV or SYS_WRITEV request. */
+#define IOV_MAX 1024
+
 #endif /* lib/syscall-nr.h */
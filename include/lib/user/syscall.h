@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -26,6 +27,7 @@ void exit(int status) NO_RETURN;
 pid_t fork(const char *thread_name);
 int exec(const char *file);
 int wait(pid_t);
+pid_t spawn(const char *cmd_line, const int fds[], size_t fd_cnt);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
 int open(const char *file);
@@ -41,6 +43,14 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+int msync(void *addr, size_t length, int flags);
+
+/* Vectored and positional I/O. */
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int pread(int fd, void *buffer, unsigned length, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned length, off_t offset);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
 
 /* Project 4 only. */
 bool chdir(const char *dir);
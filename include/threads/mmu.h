@@ -2,27 +2,56 @@
 #define THREAD_MMU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/pte.h"
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+/* Most addresses a batch of invalidations flushes one by one;
+ * beyond that it flushes the whole page map. */
+#define TLB_GATHER_MAX 32
+
+/* A batch of TLB invalidations and page tables to free. */
+struct tlb_gather {
+	uint64_t *pml4;                 /* Page map being changed. */
+	size_t va_cnt;                  /* Addresses changed, up to
+	                                   TLB_GATHER_MAX + 1. */
+	uint64_t va[TLB_GATHER_MAX];    /* The first of them. */
+	void *tables;                   /* Page tables to free, chained
+	                                   through their first entries. */
+	void *pages;                    /* Unmapped pages to free, chained
+	                                   the same way. */
+};
+
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+uint64_t *pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
 void pml4_activate (uint64_t *pml4);
+void pml4_pcid_init (void);
 void *pml4_get_page (uint64_t *pml4, const void *upage);
 bool pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
+bool pml4_set_large_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
+uint64_t *pml4_replace_large_page (uint64_t *pml4, void *upage, void *kpage,
+		bool rw);
+void pml4_split_large_page (uint64_t *pml4, void *upage, uint64_t *pt);
 void pml4_clear_page (uint64_t *pml4, void *upage);
 bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
+void pml4_set_writable (uint64_t *pml4, const void *upage, bool writable);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
+void tlb_gather_begin (struct tlb_gather *, uint64_t *pml4);
+void tlb_gather_free_tables (struct tlb_gather *, void *start, void *end);
+void tlb_gather_free_page (uint64_t *pml4, void *kva);
+void tlb_gather_end (struct tlb_gather *);
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
 #define is_kern_pte(pte) (!is_user_pte (pte))
+#define is_large_pte(pte) (*(pte) & PTE_PS)
 
 #define pte_get_paddr(pte) (pg_round_down(*(pte)))
 
@@ -31,6 +31,19 @@
 #define PTX(la) ((((uint64_t)(la)) >> PTXSHIFT) & 0x1FF)
 #define PTE_ADDR(pte) ((uint64_t)(pte) & ~0xFFF)
 
+/* A page directory entry with PTE_PS set maps a 2 MB "large page"
+   directly instead of pointing to a page table.  The frame it maps
+   must be 2 MB aligned, physically as well as virtually. */
+/* PTE_PS가 설정된 페이지 디렉터리 항목은 페이지 테이블을 가리키는 대신
+   2MB "라지 페이지"를 직접 매핑합니다. */
+#define LPGBITS 21UL                     /* Offset bits in a large page. */
+#define LPGSIZE (1UL << LPGBITS)         /* Bytes in a large page. */
+#define LPGMASK (LPGSIZE - 1)            /* Large page offset bits (0:21). */
+#define LPG_PAGES (LPGSIZE / PGSIZE)     /* Small pages per large page. */
+#define lpg_ofs(va) ((uint64_t)(va) & LPGMASK)
+#define lpg_round_down(va) ((void *)((uint64_t)(va) & ~LPGMASK))
+#define LPTE_ADDR(pde) ((uint64_t)(pde) & ~LPGMASK)
+
 /* The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
    ignored.
@@ -47,6 +60,7 @@
 #define PTE_W 0x2                           /* 1=read/write, 0=read-only. */
 #define PTE_U 0x4                           /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                          /* 1=accessed, 0=not acccessed. */
-#define PTE_D 0x40                          /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_D 0x40                          /* 1=dirty, 0=not dirty (leaf entries only). */
+#define PTE_PS 0x80                         /* 1=2 MB page (PDEs only). */
 
 #endif /* threads/pte.h */
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#ifdef USERPROG
+#include "userprog/fdt.h"
+#endif
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -86,8 +89,6 @@ typedef int tid_t;
    세마포어 대기 목록에 있기 때문에 이 두 가지 방법으로만 사용할 수 있습니다. */
 
 /* Project 2: System Call FDT */
-#define FDT_PAGES 3 // 왜 값이 3인지 THE Jungle에게 문의 필요
-#define FDT_SIZE (FDT_PAGES * (1 << 9))
 #define FDT_COUNT_LIMIT 128 // 파일 디스크립터 테이블의 최대 크기
 
 struct thread
@@ -138,12 +139,16 @@ struct thread
 	// 부모를 찾는 용도가 아닌, 데이터가 변형되지 않은 원본을 보관하기 위한 용도
 	// fork가 끝나면 의미가 없어지므로, fork가 끝나면 NULL로 초기화
 	struct intr_frame parent_if; // 부모 프로세스의 intr_frame
-	struct file **fdt;			 // 파일 디스크립터 테이블
+	struct fd_table fdt;		 // 파일 디스크립터 테이블
+	struct tlb_gather *tlb;		 /* Batch of TLB invalidations under way,
+									or NULL. */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	/* 스레드가 소유한 전체 가상 메모리에 대한 표입니다. */
 	struct supplemental_page_table spt;
+	void *user_rsp; /* User stack pointer on entry to a system call. */
+					/* 시스템 콜 진입 시의 사용자 스택 포인터. */
 #endif
 
 	/* Owned by thread.c. */
@@ -0,0 +1,38 @@
+#ifndef USERPROG_FDT_H
+#define USERPROG_FDT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct bitmap;
+struct file;
+
+/* Descriptors a new table has room for. */
+#define FDT_INIT_SIZE 16
+
+/* Most descriptors a table may grow to. */
+#define FDT_MAX_SIZE 1536
+
+/* A process's file descriptor table.
+ *
+ * Descriptors 0 and 1 are the console and have no file.  The table
+ * starts with room for FDT_INIT_SIZE descriptors and doubles when
+ * it fills up.  A bitmap of the descriptors in use gives the lowest
+ * free one with a find-first-zero, and lets copying and closing the
+ * table visit only the open ones. */
+struct fd_table {
+	struct file **files;        /* File of each descriptor, or NULL. */
+	struct bitmap *used;        /* Descriptors in use. */
+	size_t size;                /* Number of descriptors there is
+	                               room for. */
+};
+
+bool fdt_init (struct fd_table *);
+void fdt_destroy (struct fd_table *);
+bool fdt_duplicate (struct fd_table *dst, const struct fd_table *src);
+int fdt_add (struct fd_table *, struct file *);
+bool fdt_install (struct fd_table *, int fd, struct file *);
+struct file *fdt_get (const struct fd_table *, int fd);
+void fdt_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdt.h */
@@ -1,13 +1,28 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
+struct frame;
+struct zswap_entry;
 enum vm_type;
 
+/* Swap slot index of a page that is not in swap. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
+/* Most pages written to swap by one eviction. */
+#define SWAP_CLUSTER 8
+
 struct anon_page {
+	size_t swap_slot;      /* Slot holding the page, or SWAP_SLOT_NONE. */
+	struct zswap_entry *zswap; /* Compressed copy, or NULL. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_swap_out_cluster (struct page *pages[], size_t cnt,
+		bool written[]);
+bool anon_swap_out_shared (struct frame *frame);
+void anon_print_stats (void);
 
 #endif
@@ -6,12 +6,37 @@
 struct page;
 enum vm_type;
 
+/* Marks, in the type given to vm_alloc_page_with_initializer(), a
+ * VM_FILE page that maps a read-only part of an executable.  Such
+ * pages of the same file and offset share one frame through the
+ * text cache in vm.c. */
+#define VM_TEXT VM_MARKER_0
+
 struct file_page {
+	struct file *file;     /* File the page is read from, owned. */
+	off_t ofs;             /* Offset of the page's data in FILE. */
+	size_t read_bytes;     /* Bytes read from FILE; the rest is zero. */
+	bool text;             /* A VM_TEXT page? */
+	void *map;             /* Start of its mmap() mapping, or NULL. */
+};
+
+/* Where the contents of a lazily loaded page come from.  Passed as
+ * the AUX of an uninit page, which owns both the struct and FILE
+ * until the page is first loaded or destroyed. */
+struct file_segment {
+	struct file *file;     /* File to read, opened for this page alone. */
+	off_t ofs;             /* Offset of the page's data in FILE. */
+	size_t read_bytes;     /* Bytes to read; the rest is zeroed. */
+	void *map;             /* Start of the mmap() mapping the page is
+	                          part of, or NULL. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+void file_backed_prepare (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool do_msync (void *addr, size_t length, int flags);
+void file_writeback_sync (struct inode *inode);
 #endif
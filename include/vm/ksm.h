@@ -0,0 +1,14 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+
+/* Frames ksmd scans for merging each time it wakes up.  0, the
+ * default, leaves ksmd off. */
+extern unsigned ksm_pages_per_pass;
+
+/* Milliseconds ksmd sleeps between passes. */
+extern unsigned ksm_sleep_ms;
+
+void ksm_init (void);
+void ksm_print_stats (void);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef VM_THP_H
+#define VM_THP_H
+
+#include <stdbool.h>
+
+/* Map 2 MB regions of anonymous memory with large pages, when they
+ * are faulted in whole or once khugepaged finds them fully
+ * resident.  Off by default. */
+extern bool thp_enabled;
+
+/* Milliseconds khugepaged sleeps between passes. */
+extern unsigned thp_sleep_ms;
+
+void thp_init (void);
+void thp_print_stats (void);
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -33,6 +36,7 @@ enum vm_type {
 
 struct page_operations;
 struct thread;
+struct thp;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -46,6 +50,15 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	bool writable;         /* May the user process write to the page? */
+	uint64_t *pml4;        /* Page map the page is installed into. */
+	bool in_test;          /* Evicted while in its CLOCK-Pro test period? */
+	struct list_elem test_elem; /* Element in the non-resident test list. */
+	struct list_elem frame_elem; /* Element in its frame's page list. */
+	bool zero;             /* Mapped read-only to the shared zero page? */
+	struct supplemental_page_table *spt; /* Table the page is in. */
+	bool ws_ref;           /* Accessed bit taken by a hand, not yet seen
+	                          by the working-set sampler? */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -59,10 +72,43 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* Where a frame is in the CLOCK-Pro replacement lists. */
+enum frame_state {
+	FRAME_UNLISTED,        /* Not in the frame table (yet). */
+	FRAME_HOT,             /* On the hot list. */
+	FRAME_COLD,            /* On the cold list. */
+};
+
+/* The representation of "frame".
+ * After fork, a frame may be shared copy-on-write by several pages,
+ * all mapped read-only; PAGE is the first of them.  A frame holding
+ * a page of an executable's text is shared, also read-only, by the
+ * VM_TEXT pages of every process mapping it, and is in the text
+ * cache under its file position. */
 struct frame {
 	void *kva;
 	struct page *page;
+	size_t ref_cnt;             /* Number of pages mapped to the frame. */
+	struct list pages;          /* Those pages. */
+	struct inode *inode;        /* Text cache key: file, or NULL if the
+	                               frame is not in the cache, */
+	off_t ofs;                  /* ...offset of the data in it, */
+	size_t read_bytes;          /* ...and its length. */
+	struct hash_elem text_elem; /* Element in the text cache. */
+	uint64_t ksm_hash;          /* Merge index key: hash of contents, */
+	bool ksm_indexed;           /* ...if the frame is in the index. */
+	unsigned ksm_round;         /* Last merge scan that looked at it. */
+	enum frame_state state;     /* Replacement list the frame is on. */
+	bool test;                  /* Cold frame in its test period? */
+	unsigned pin_cnt;           /* Number of pins held on it; it must
+	                               not be evicted while nonzero. */
+	bool writeback;             /* Being written back to its file, or
+	                               out by an eviction? */
+	bool referenced;            /* Accessed bit taken by the working-set
+	                               sampler, not yet seen by a hand? */
+	struct thp *thp;            /* Huge page the frame is part of, or
+	                               NULL. */
+	struct list_elem clock_elem; /* Element in the hot or cold list. */
 };
 
 /* The function table for page operations.
@@ -82,11 +128,52 @@ struct page_operations {
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
 /* Representation of current process's memory space.
- * We don't want to force you to obey any specific design for this struct.
- * All designs up to you for this. */
+ *
+ * A 4-level radix tree indexed by virtual page number, shaped like
+ * the x86-64 page table: each node is one page of 512 pointers, the
+ * root is indexed by bits 39..47 of the address like the PML4, and
+ * the last level is indexed by bits 12..20 like a page table and
+ * points to the struct pages.  A lookup is four dependent loads,
+ * and walking a range touches only the nodes that cover mapped
+ * pages.
+ *
+ * Only the owning process changes its table, and it does so
+ * holding LOCK: inserting and removing pages, and unlinking the
+ * whole tree in supplemental_page_table_kill().  A node is fully
+ * initialized before the pointer to it is stored, and pages and
+ * nodes are only freed once unlinked, after LOCK is released.  So
+ * the owner looks pages up without locking, and so may a thread it
+ * waits for, such as its child copying it in fork().  Any other
+ * thread must hold LOCK for as long as it uses what it finds; the
+ * pages it finds are then not freed under it.  LOCK is taken after
+ * the frame lock, never before it.  Interior nodes are only freed
+ * by supplemental_page_table_kill(). */
+#define SPT_LEVELS 4
+#define SPT_FANOUT (PGSIZE / sizeof (void *))
+
 struct supplemental_page_table {
+	struct lock lock;      /* Held to change the tree. */
+	void **root;           /* Level 0 node, or NULL if empty. */
+	size_t page_cnt;       /* Number of pages in the table. */
+	void *fault_next;      /* Page after the last fault-around window. */
+	size_t fault_window;   /* Pages to load after the next file fault. */
+	size_t rss;            /* Pages mapped to frames. */
+	size_t wss;            /* Pages referenced in the last sample window. */
+	int64_t ws_sampled;    /* Timer tick the last sample window ended. */
 };
 
+/* Resident set limits, in pages, that apply to each process.  0, the
+ * default, means no limit.  Under memory pressure, the cold pages of
+ * a process over the soft limit are evicted before anyone else's; a
+ * process at the hard limit evicts one of its own pages for each new
+ * one. */
+extern unsigned rss_soft_limit;
+extern unsigned rss_hard_limit;
+
+/* Performs some operation on PAGE, given auxiliary data AUX.
+ * Returns false to stop the iteration. */
+typedef bool spt_action_func (struct page *page, void *aux);
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -96,6 +183,8 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_for_each (struct supplemental_page_table *spt, void *start,
+		void *end, spt_action_func *action, void *aux);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -107,6 +196,19 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_claim_cached_page (void *va);
+void vm_free_frame (struct page *page);
+bool vm_stack_access (const void *addr, const void *rsp);
+bool vm_pin_buffer (const void *buffer, size_t size, bool write);
+void vm_unpin_buffer (const void *buffer, size_t size);
+size_t vm_ksm_scan (size_t cnt, size_t *merged);
+size_t vm_thp_collapse (size_t max);
+void vm_thp_stats (size_t *faults, size_t *splits);
+void *vm_writeback_begin (struct page *page);
+size_t vm_writeback_gather (struct page *pages[], size_t max);
+void vm_writeback_end (struct page *page);
+void *vm_take_dirty_frame (struct page *page);
 enum vm_type page_get_type (struct page *page);
+void vm_print_stats (void);
 
 #endif  /* VM_VM_H */
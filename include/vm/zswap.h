@@ -0,0 +1,26 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+/* Writes the contents of PAGE, at KVA, to the swap disk and
+ * records where.  Returns false if there is no room. */
+typedef bool zswap_writeback_func (struct page *page, const void *kva);
+
+/* Largest value zswap_max_percent may take. */
+#define ZSWAP_MAX_PERCENT 50
+
+/* Largest share of the kernel pool, in percent, the compressed pool
+ * may take up before it writes pages back to disk.  0 disables the
+ * compressed pool. */
+extern unsigned zswap_max_percent;
+
+void zswap_init (zswap_writeback_func *);
+bool zswap_store (struct page *, const void *kva);
+bool zswap_load (struct page *, void *kva);
+void zswap_invalidate (struct page *);
+void zswap_print_stats (void);
+
+#endif
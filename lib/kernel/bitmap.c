@@ -70,6 +70,84 @@ last_mask(const struct bitmap *b)
 	return last_bits ? ((elem_type)1 << last_bits) - 1 : (elem_type)-1;
 }
 
+/* Returns a mask of the CNT bits starting at bit OFS of an
+   element.  OFS + CNT must not exceed ELEM_BITS. */
+static inline elem_type
+range_mask(size_t ofs, size_t cnt)
+{
+	elem_type mask = cnt < ELEM_BITS ? ((elem_type)1 << cnt) - 1 : (elem_type)-1;
+	return mask << ofs;
+}
+
+/* Returns the number of 1-bits in X.  The kernel is not linked
+   with libgcc, so __builtin_popcountl() is not available. */
+static inline size_t
+popcount(elem_type x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to VALUE, or B's bit count if there is none.  Works an
+   element at a time: elements with no matching bit are skipped
+   whole, and the first match in an element is found with a
+   count-trailing-zeros instruction. */
+/* START 이후에서 VALUE로 설정된 첫 번째 비트의 인덱스를 반환합니다.
+   일치하는 비트가 없는 요소는 한 번에 건너뜁니다. */
+static size_t
+find_next(const struct bitmap *b, size_t start, bool value)
+{
+	if (start >= b->bit_cnt)
+		return b->bit_cnt;
+
+	/* XOR-ing with FLIP turns the bits we look for into 1s. */
+	elem_type flip = value ? 0 : (elem_type)-1;
+	size_t idx = elem_idx(start);
+	size_t last = elem_cnt(b->bit_cnt);
+	elem_type word = (b->bits[idx] ^ flip) & ((elem_type)-1 << (start % ELEM_BITS));
+
+	while (word == 0)
+	{
+		if (++idx >= last)
+			return b->bit_cnt;
+		word = b->bits[idx] ^ flip;
+	}
+
+	size_t bit = idx * ELEM_BITS + __builtin_ctzl(word);
+	return bit < b->bit_cnt ? bit : b->bit_cnt;
+}
+
+/* Returns the start of the first group of CNT consecutive bits in
+   B that are all set to VALUE and lie entirely within
+   [START, END), or BITMAP_ERROR if there is none.  CNT must be
+   nonzero.  Each step jumps from the start of a candidate run to
+   its end with find_next(), so the cost is proportional to the
+   number of elements and runs examined, not to CNT. */
+static size_t
+scan_range(const struct bitmap *b, size_t start, size_t end, size_t cnt,
+		   bool value)
+{
+	ASSERT(cnt > 0);
+
+	while (start < end && end - start >= cnt)
+	{
+		size_t first = find_next(b, start, value);
+
+		if (first >= end || end - first < cnt)
+			break;
+
+		size_t stop = find_next(b, first, !value);
+
+		if (stop - first >= cnt)
+			return first;
+		start = stop;
+	}
+	return BITMAP_ERROR;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -227,9 +305,22 @@ void bitmap_set_multiple(struct bitmap *b, size_t start, size_t cnt, bool value)
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
-	for (size_t i = 0; i < cnt; i++)
+	/* Update an element at a time, each atomically as in
+	   bitmap_mark() and bitmap_reset(). */
+	while (cnt > 0)
 	{
-		bitmap_set(b, start + i, value);
+		size_t ofs = start % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+		elem_type mask = range_mask(ofs, n);
+		elem_type *elem = &b->bits[elem_idx(start)];
+
+		if (value)
+			asm("lock orq %1, %0" : "+m"(*elem) : "r"(mask) : "cc");
+		else
+			asm("lock andq %1, %0" : "+m"(*elem) : "r"(~mask) : "cc");
+
+		start += n;
+		cnt -= n;
 	}
 }
 
@@ -238,16 +329,24 @@ void bitmap_set_multiple(struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-	size_t i, value_cnt;
+	size_t value_cnt;
 
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test(b, start + i) == value)
-			value_cnt++;
+	while (cnt > 0)
+	{
+		size_t ofs = start % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+		elem_type mask = range_mask(ofs, n);
+		size_t ones = popcount(b->bits[elem_idx(start)] & mask);
+
+		value_cnt += value ? ones : n - ones;
+		start += n;
+		cnt -= n;
+	}
 	return value_cnt;
 }
 
@@ -257,16 +356,11 @@ bitmap_count(const struct bitmap *b, size_t start, size_t cnt, bool value)
    참을 반환하고, 그렇지 않으면 거짓을 반환합니다. */
 bool bitmap_contains(const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-	size_t i;
-
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 	ASSERT(start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test(b, start + i) == value)
-			return true;
-	return false;
+	return cnt > 0 && find_next(b, start, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -307,15 +401,58 @@ size_t bitmap_scan(const struct bitmap *b, size_t start, size_t cnt, bool value)
 	ASSERT(b != NULL);
 	ASSERT(start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt)
-	{
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains(b, i, cnt, !value))
-				return i;
-	}
-	return BITMAP_ERROR;
+	if (cnt == 0)
+		return start;
+	return scan_range(b, start, b->bit_cnt, cnt, value);
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to VALUE, or BITMAP_ERROR if there is none.  With VALUE
+   false this is a "find first zero" operation. */
+/* START 이후에서 VALUE로 설정된 첫 번째 비트의 인덱스를 반환하고,
+   없으면 BITMAP_ERROR를 반환합니다. */
+size_t bitmap_find_next(const struct bitmap *b, size_t start, bool value)
+{
+	ASSERT(b != NULL);
+	ASSERT(start <= b->bit_cnt);
+
+	size_t idx = find_next(b, start, value);
+	return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+}
+
+/* Next-fit variant of bitmap_scan().  Searches for CNT
+   consecutive bits set to VALUE starting at *CURSOR, wrapping
+   around to the beginning of B if none are found before the end.
+   On success, advances *CURSOR past the group found and returns
+   its first index; otherwise returns BITMAP_ERROR and leaves
+   *CURSOR unchanged.  Starting where the previous search ended
+   avoids rescanning the densely used front of the bitmap on every
+   allocation.  *CURSOR is owned by the caller and should start
+   at 0. */
+/* bitmap_scan()의 next-fit 버전입니다. *CURSOR에서 검색을 시작하고
+   끝에 도달하면 처음부터 다시 검색합니다. 성공하면 *CURSOR를 찾은
+   그룹 뒤로 옮깁니다. */
+size_t bitmap_scan_next_fit(const struct bitmap *b, size_t *cursor, size_t cnt,
+							bool value)
+{
+	ASSERT(b != NULL);
+	ASSERT(cursor != NULL);
+
+	size_t start = *cursor < b->bit_cnt ? *cursor : 0;
+	size_t idx;
+
+	if (cnt == 0)
+		return start;
+
+	idx = scan_range(b, start, b->bit_cnt, cnt, value);
+	/* Runs wholly after START were tried; on wrapping around,
+	   only runs that begin before START remain. */
+	if (idx == BITMAP_ERROR && start > 0)
+		idx = scan_range(b, 0, start + cnt - 1 < b->bit_cnt ? start + cnt - 1 : b->bit_cnt,
+						 cnt, value);
+	if (idx != BITMAP_ERROR)
+		*cursor = idx + cnt;
+	return idx;
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -343,6 +480,23 @@ size_t bitmap_scan_and_flip(struct bitmap *b, size_t start, size_t cnt, bool val
 	return idx;
 }
 
+/* Like bitmap_scan_and_flip(), but searches next-fit from *CURSOR
+   as bitmap_scan_next_fit() does. */
+/* bitmap_scan_and_flip()과 같지만 bitmap_scan_next_fit()처럼
+   *CURSOR에서 next-fit으로 검색합니다. */
+size_t bitmap_scan_and_flip_next_fit(struct bitmap *b, size_t *cursor,
+									 size_t cnt, bool value)
+{
+	size_t idx = bitmap_scan_next_fit(b, cursor, cnt, value);
+
+	if (idx != BITMAP_ERROR)
+	{
+		bitmap_set_multiple(b, idx, cnt, !value);
+	}
+
+	return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -7,6 +7,7 @@
 
 #include "hash.h"
 #include "../debug.h"
+#include <string.h>
 #include "threads/malloc.h"
 
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
@@ -235,47 +236,77 @@ hash_empty (struct hash *h) {
 	return h->elem_cnt == 0;
 }
 
-/* Fowler-Noll-Vo hash constants, for 32-bit word sizes. */
-#define FNV_64_PRIME 0x00000100000001B3UL
-#define FNV_64_BASIS 0xcbf29ce484222325UL
+/* MurmurHash64A multiplier and shift. */
+#define MURMUR_M 0xc6a4a7935bd1e995UL
+#define MURMUR_R 47
+#define MURMUR_SEED 0xcbf29ce484222325UL
+
+/* A 64-bit word that may be read from any byte address. */
+typedef uint64_t unaligned_u64 __attribute__ ((aligned (1), may_alias));
 
 /* Returns a hash of the SIZE bytes in BUF. */
 uint64_t
 hash_bytes (const void *buf_, size_t size) {
-	/* Fowler-Noll-Vo 32-bit hash, for bytes. */
+	/* MurmurHash64A, which mixes in eight bytes per multiply
+	   where FNV needs a multiply for every byte. */
 	const unsigned char *buf = buf_;
 	uint64_t hash;
 
 	ASSERT (buf != NULL);
 
-	hash = FNV_64_BASIS;
-	while (size-- > 0)
-		hash = (hash * FNV_64_PRIME) ^ *buf++;
+	hash = MURMUR_SEED ^ (size * MURMUR_M);
+	for (; size >= 8; size -= 8, buf += 8) {
+		uint64_t k = *(const unaligned_u64 *) buf;
+
+		k *= MURMUR_M;
+		k ^= k >> MURMUR_R;
+		k *= MURMUR_M;
+		hash ^= k;
+		hash *= MURMUR_M;
+	}
+
+	if (size > 0) {
+		while (size-- > 0)
+			hash ^= (uint64_t) buf[size] << (size * 8);
+		hash *= MURMUR_M;
+	}
 
+	hash ^= hash >> MURMUR_R;
+	hash *= MURMUR_M;
+	hash ^= hash >> MURMUR_R;
 	return hash;
 }
 
 /* Returns a hash of string S. */
 uint64_t
-hash_string (const char *s_) {
-	const unsigned char *s = (const unsigned char *) s_;
-	uint64_t hash;
-
+hash_string (const char *s) {
 	ASSERT (s != NULL);
 
-	hash = FNV_64_BASIS;
-	while (*s != '\0')
-		hash = (hash * FNV_64_PRIME) ^ *s++;
-
-	return hash;
+	return hash_bytes (s, strlen (s));
 }
 
 /* Returns a hash of integer I. */
 uint64_t
 hash_int (int i) {
-	return hash_bytes (&i, sizeof i);
+	return hash_ptr ((unsigned) i);
 }
-
+
+/* Returns a hash of pointer-sized value X.  This is the 64-bit
+   finalizer of MurmurHash3, which spreads every input bit over
+   the whole result, so keys that differ only in their high bits,
+   such as page addresses, still land in different buckets. */
+uint64_t
+hash_ptr (uintptr_t x) {
+	uint64_t hash = x;
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdUL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53UL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
 /* Returns the bucket in H that E belongs in. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) {
@@ -392,3 +423,283 @@ remove_elem (struct hash *h, struct hash_elem *e) {
 	list_remove (&e->list_elem);
 }
 
+
+/* Open-addressing hash table. */
+
+/* Number of slots in a table when the first entry is inserted. */
+#define PHASH_MIN_SLOTS 16
+
+/* A table grows once more than LOAD_NUM / LOAD_DEN of its slots
+   would be used.  Robin-hood probing keeps probe sequences short
+   up to high loads, so this can be much higher than is sensible
+   for plain linear probing. */
+#define PHASH_LOAD_NUM 7
+#define PHASH_LOAD_DEN 8
+
+/* Number of old slots migrated by each insertion or deletion
+   while the table is growing.  The new table has twice as many
+   slots, so this finishes the migration long before the new
+   table itself needs to grow. */
+#define PHASH_MIGRATE_STEP 4
+
+static struct phash_slot *table_find (struct phash_table *, uintptr_t,
+		uint64_t);
+static void table_insert (struct phash_table *, uintptr_t, void *, uint64_t);
+static void table_remove (struct phash_table *, struct phash_slot *);
+static void table_apply (struct phash_table *, phash_action_func *, void *);
+static void migrate (struct phash *, size_t step);
+static bool grow (struct phash *);
+
+/* Initializes H as an empty table.  No memory is allocated until
+   the first insertion. */
+void
+phash_init (struct phash *h) {
+	ASSERT (h != NULL);
+
+	h->cur.slot_cnt = h->cur.elem_cnt = 0;
+	h->cur.slots = NULL;
+	h->cur.dist = NULL;
+	h->old = h->cur;
+	h->migrate_pos = 0;
+}
+
+/* Destroys H.  If ACTION is non-null, it is first called for
+   each entry, given auxiliary data AUX, and may free the entry's
+   value. */
+void
+phash_destroy (struct phash *h, phash_action_func *action, void *aux) {
+	if (action != NULL)
+		phash_apply (h, action, aux);
+	free (h->cur.slots);
+	free (h->old.slots);
+	phash_init (h);
+}
+
+/* Inserts KEY with VALUE into H.  Returns true if successful,
+   false if KEY is already in H or if H was full and memory to
+   grow it could not be allocated.  VALUE must not be null. */
+bool
+phash_insert (struct phash *h, uintptr_t key, void *value) {
+	uint64_t hash = hash_ptr (key);
+
+	ASSERT (value != NULL);
+
+	if (phash_find (h, key) != NULL)
+		return false;
+
+	if ((phash_size (h) + 1) * PHASH_LOAD_DEN
+			> h->cur.slot_cnt * PHASH_LOAD_NUM && !grow (h)) {
+		/* Keep using the current table as long as it has a
+		   free slot left to end unsuccessful searches. */
+		migrate (h, SIZE_MAX);
+		if (h->cur.elem_cnt + 2 > h->cur.slot_cnt)
+			return false;
+	}
+
+	table_insert (&h->cur, key, value, hash);
+	migrate (h, PHASH_MIGRATE_STEP);
+	return true;
+}
+
+/* Returns the value of KEY in H, or a null pointer if KEY is not
+   in H. */
+void *
+phash_find (struct phash *h, uintptr_t key) {
+	uint64_t hash = hash_ptr (key);
+	struct phash_slot *slot = table_find (&h->cur, key, hash);
+
+	if (slot == NULL)
+		slot = table_find (&h->old, key, hash);
+	return slot != NULL ? slot->value : NULL;
+}
+
+/* Removes KEY from H and returns its value, or returns a null
+   pointer if KEY was not in H. */
+void *
+phash_delete (struct phash *h, uintptr_t key) {
+	uint64_t hash = hash_ptr (key);
+	struct phash_table *t = &h->cur;
+	struct phash_slot *slot = table_find (t, key, hash);
+	void *value;
+
+	if (slot == NULL) {
+		t = &h->old;
+		slot = table_find (t, key, hash);
+		if (slot == NULL)
+			return NULL;
+	}
+
+	value = slot->value;
+	table_remove (t, slot);
+	migrate (h, PHASH_MIGRATE_STEP);
+	return value;
+}
+
+/* Calls ACTION for each entry in H in arbitrary order, given
+   auxiliary data AUX.  ACTION must not modify H. */
+void
+phash_apply (struct phash *h, phash_action_func *action, void *aux) {
+	ASSERT (action != NULL);
+
+	table_apply (&h->cur, action, aux);
+	table_apply (&h->old, action, aux);
+}
+
+/* Returns the number of entries in H. */
+size_t
+phash_size (struct phash *h) {
+	return h->cur.elem_cnt + h->old.elem_cnt;
+}
+
+/* Returns the slot of T holding KEY, whose hash is HASH, or a
+   null pointer if there is none.  Robin-hood ordering means the
+   search can stop at the first slot whose entry is closer to its
+   home than KEY would be at that point. */
+static struct phash_slot *
+table_find (struct phash_table *t, uintptr_t key, uint64_t hash) {
+	size_t mask = t->slot_cnt - 1;
+	size_t i;
+	unsigned dist;
+
+	if (t->elem_cnt == 0)
+		return NULL;
+
+	for (i = hash & mask, dist = 1; t->dist[i] >= dist;
+			i = (i + 1) & mask, dist++)
+		if (t->slots[i].key == key)
+			return &t->slots[i];
+	return NULL;
+}
+
+/* Inserts KEY with VALUE, whose hash is HASH, into T, which must
+   not already contain KEY and must have a free slot. */
+static void
+table_insert (struct phash_table *t, uintptr_t key, void *value,
+		uint64_t hash) {
+	size_t mask = t->slot_cnt - 1;
+	size_t i = hash & mask;
+	unsigned dist = 1;
+
+	ASSERT (t->elem_cnt < t->slot_cnt);
+
+	for (;; i = (i + 1) & mask, dist++) {
+		struct phash_slot *slot = &t->slots[i];
+
+		ASSERT (dist <= UINT8_MAX);
+		if (t->dist[i] == 0) {
+			slot->key = key;
+			slot->value = value;
+			t->dist[i] = dist;
+			t->elem_cnt++;
+			return;
+		}
+		if (t->dist[i] < dist) {
+			/* Take the slot from the entry nearer its home and
+			   carry on inserting that entry instead. */
+			struct phash_slot displaced = *slot;
+			unsigned displaced_dist = t->dist[i];
+
+			slot->key = key;
+			slot->value = value;
+			t->dist[i] = dist;
+			key = displaced.key;
+			value = displaced.value;
+			dist = displaced_dist;
+		}
+	}
+}
+
+/* Removes SLOT from T by shifting the entries that follow it
+   back by one, until one is reached that is already in its home
+   slot.  Unlike tombstones, this leaves the table exactly as if
+   the entry had never been inserted. */
+static void
+table_remove (struct phash_table *t, struct phash_slot *slot) {
+	size_t mask = t->slot_cnt - 1;
+	size_t i = slot - t->slots;
+	size_t next;
+
+	for (next = (i + 1) & mask; t->dist[next] > 1;
+			i = next, next = (next + 1) & mask) {
+		t->slots[i] = t->slots[next];
+		t->dist[i] = t->dist[next] - 1;
+	}
+	t->dist[i] = 0;
+	t->elem_cnt--;
+}
+
+/* Calls ACTION for each entry in T, given auxiliary data AUX. */
+static void
+table_apply (struct phash_table *t, phash_action_func *action, void *aux) {
+	size_t i;
+
+	for (i = 0; i < t->slot_cnt; i++)
+		if (t->dist[i] != 0)
+			action (t->slots[i].key, t->slots[i].value, aux);
+}
+
+/* Moves the entries of up to STEP slots of H's old table into
+   its current table, and frees the old table once it is empty.
+
+   Slots are visited in index order and each entry is removed
+   with table_remove(), which may shift a later entry into the
+   slot just emptied, so a slot is only passed over once it is
+   empty.  Every slot before MIGRATE_POS therefore stays empty,
+   which keeps the old table a valid robin-hood table that
+   lookups and deletions can keep using. */
+static void
+migrate (struct phash *h, size_t step) {
+	struct phash_table *old = &h->old;
+
+	if (old->slots == NULL)
+		return;
+
+	while (step-- > 0 && old->elem_cnt > 0) {
+		size_t i = h->migrate_pos;
+
+		if (old->dist[i] != 0) {
+			struct phash_slot s = old->slots[i];
+
+			table_remove (old, &old->slots[i]);
+			table_insert (&h->cur, s.key, s.value, hash_ptr (s.key));
+		} else
+			h->migrate_pos++;
+	}
+
+	if (old->elem_cnt == 0) {
+		free (old->slots);
+		old->slots = NULL;
+		old->dist = NULL;
+		old->slot_cnt = 0;
+		h->migrate_pos = 0;
+	}
+}
+
+/* Replaces H's current table with an empty one twice its size,
+   making the current table the old one to be migrated.  Any
+   migration still in progress is finished first.  Returns false
+   if memory could not be allocated. */
+static bool
+grow (struct phash *h) {
+	size_t slot_cnt = h->cur.slot_cnt ? h->cur.slot_cnt * 2 : PHASH_MIN_SLOTS;
+	struct phash_slot *slots;
+
+	/* The slots and their distances share one allocation. */
+	slots = malloc (slot_cnt * (sizeof *slots + sizeof *h->cur.dist));
+	if (slots == NULL)
+		return false;
+
+	migrate (h, SIZE_MAX);
+	h->old = h->cur;
+	h->migrate_pos = 0;
+
+	h->cur.slot_cnt = slot_cnt;
+	h->cur.elem_cnt = 0;
+	h->cur.slots = slots;
+	h->cur.dist = (uint8_t *) (slots + slot_cnt);
+	memset (h->cur.dist, 0, slot_cnt);
+
+	if (h->old.slot_cnt == 0)
+		h->old.slots = NULL;
+	return true;
+}
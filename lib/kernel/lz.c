@@ -0,0 +1,206 @@
+#include "lz.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+
+/* A match is at least this long. */
+#define MIN_MATCH 4
+
+/* No match may start within this many bytes of the end of the
+   input, and the last this-many bytes are always literals, so a
+   decoder can finish with a plain copy. */
+#define MATCH_GUARD 12
+#define LAST_LITERALS 5
+
+/* Largest match offset the two-byte field holds. */
+#define MAX_OFFSET 65535
+
+/* log2 of the number of entries in the match-finding table. */
+#define HASH_BITS 12
+
+/* Hash table entries are 16-bit input offsets. */
+typedef uint16_t hash_entry;
+
+/* Unaligned 32-bit load. */
+typedef uint32_t unaligned_u32 __attribute__ ((aligned (1), may_alias));
+
+static inline uint32_t
+read32 (const uint8_t *p) {
+	return *(const unaligned_u32 *) p;
+}
+
+/* Hashes the 4-byte sequence SEQ into the match-finding table. */
+static inline size_t
+hash_seq (uint32_t seq) {
+	return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Writes the extra bytes for a length field of LEN that did not
+   fit in its nibble, at OP, and returns the end of what was
+   written. */
+static uint8_t *
+put_length (uint8_t *op, size_t len) {
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/* Returns the most bytes a run with LIT_CNT literals and a match
+   of MATCH_LEN bytes can take up, counting the match as 0 for the
+   final run, which has none. */
+static size_t
+run_size (size_t lit_cnt, size_t match_len) {
+	return 1 + lit_cnt / 255 + 1 + lit_cnt
+		+ (match_len > 0 ? 2 + match_len / 255 + 1 : 0);
+}
+
+/* Emits a run of the LIT_CNT bytes at LIT followed by a match of
+   MATCH_LEN bytes OFFSET bytes back, or no match if MATCH_LEN is
+   0, at *OP.  Returns false without writing anything if the run
+   would not end at or before OEND. */
+static bool
+put_run (uint8_t **op, const uint8_t *oend, const uint8_t *lit,
+		size_t lit_cnt, size_t offset, size_t match_len) {
+	uint8_t *p = *op;
+	uint8_t *token;
+	size_t ml = match_len > 0 ? match_len - MIN_MATCH : 0;
+
+	if (run_size (lit_cnt, match_len) > (size_t) (oend - p))
+		return false;
+
+	token = p++;
+	*token = (lit_cnt < 15 ? lit_cnt : 15) << 4;
+	if (lit_cnt >= 15)
+		p = put_length (p, lit_cnt - 15);
+	memcpy (p, lit, lit_cnt);
+	p += lit_cnt;
+
+	if (match_len > 0) {
+		*p++ = offset & 0xff;
+		*p++ = offset >> 8;
+		*token |= ml < 15 ? ml : 15;
+		if (ml >= 15)
+			p = put_length (p, ml - 15);
+	}
+	*op = p;
+	return true;
+}
+
+/* Compresses the SRC_SIZE bytes at SRC, at most LZ_MAX_INPUT, into
+   DST, which has room for DST_CAP bytes.  WORK must point to
+   LZ_WORK_SIZE bytes of scratch memory, which need not be
+   initialized.  Returns the compressed size, or 0 if the result
+   would not fit in DST_CAP bytes. */
+size_t
+lz_compress (const void *src_, size_t src_size, void *dst_, size_t dst_cap,
+		void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *ip = src, *anchor = src;
+	const uint8_t *iend = src + src_size;
+	uint8_t *op = dst_, *oend = op + dst_cap;
+	hash_entry *table = work;
+
+	ASSERT (src_size <= LZ_MAX_INPUT);
+	ASSERT (sizeof (hash_entry) << HASH_BITS <= LZ_WORK_SIZE);
+
+	memset (table, 0, sizeof (hash_entry) << HASH_BITS);
+	if (src_size > MATCH_GUARD) {
+		const uint8_t *match_limit = iend - MATCH_GUARD;
+		const uint8_t *extend_limit = iend - LAST_LITERALS;
+
+		ip++;
+		while (ip < match_limit) {
+			uint32_t seq = read32 (ip);
+			size_t h = hash_seq (seq);
+			const uint8_t *ref = src + table[h];
+			size_t len;
+
+			table[h] = ip - src;
+			if (ip - ref > MAX_OFFSET || read32 (ref) != seq) {
+				/* Step faster through input that keeps failing to
+				   match, which is likely incompressible. */
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			for (len = MIN_MATCH; ip + len < extend_limit
+					&& ip[len] == ref[len]; len++)
+				continue;
+			if (!put_run (&op, oend, anchor, ip - anchor, ip - ref, len))
+				return 0;
+			ip += len;
+			anchor = ip;
+			if (ip < match_limit)
+				table[hash_seq (read32 (ip - 2))] = ip - 2 - src;
+		}
+	}
+
+	if (!put_run (&op, oend, anchor, iend - anchor, 0, 0))
+		return 0;
+	return op - (uint8_t *) dst_;
+}
+
+/* Reads a length field's extra bytes from *IP, which must stay
+   below IEND, adding them to *LEN.  Returns false if the input
+   ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into DST.  Returns true if they decompress to
+   exactly DST_SIZE bytes, false if they are malformed or
+   decompress to anything else.  Never reads or writes outside the
+   given buffers. */
+bool
+lz_decompress (const void *src, size_t src_size, void *dst, size_t dst_size) {
+	const uint8_t *ip = src, *iend = ip + src_size;
+	uint8_t *op = dst, *oend = op + dst_size;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit_cnt = token >> 4;
+		size_t match_len = token & 15;
+		size_t offset;
+
+		if (lit_cnt == 15 && !get_length (&ip, iend, &lit_cnt))
+			return false;
+		if (lit_cnt > (size_t) (iend - ip) || lit_cnt > (size_t) (oend - op))
+			return false;
+		memcpy (op, ip, lit_cnt);
+		ip += lit_cnt;
+		op += lit_cnt;
+
+		/* The final run has literals only. */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t) (op - (uint8_t *) dst))
+			return false;
+		if (match_len == 15 && !get_length (&ip, iend, &match_len))
+			return false;
+		match_len += MIN_MATCH;
+		if (match_len > (size_t) (oend - op))
+			return false;
+
+		/* Byte by byte, since the match may overlap its own
+		   output. */
+		for (; match_len > 0; match_len--, op++)
+			*op = *(op - offset);
+	}
+	return op == oend;
+}
@@ -1,5 +1,118 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Word type used by the word-at-a-time paths below.  Marked
+   may_alias so that reading arbitrary byte buffers through it does
+   not break strict aliasing, and aligned(1) so that unaligned loads
+   and stores are allowed (x86-64 handles them in hardware). */
+typedef uint64_t __attribute__((may_alias, aligned(1))) word_t;
+
+#define WORD_SIZE sizeof(uint64_t)
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* Nonzero if word V contains a zero byte. */
+#define HAS_ZERO(V) (((V) - ONES) & ~(V) & HIGHS)
+
+/* Blocks at least this large are handed to the string instructions.
+   Below it, the startup cost of `rep movs'/`rep stos' outweighs the
+   benefit and a plain word loop is faster. */
+#define REP_THRESHOLD 64
+
+/* Returns true if the CPU advertises Enhanced REP MOVSB/STOSB
+   (CPUID.(EAX=07H,ECX=0):EBX[bit 9]).  With ERMS, byte-granular
+   `rep movsb'/`rep stosb' are the fastest way to move large blocks,
+   since the microcode picks the widest internal transfer size itself.
+   The result is cached after the first call.  CPUID is unprivileged,
+   so this works the same in the kernel and in user programs. */
+static bool
+has_erms(void)
+{
+	static int erms = -1;
+
+	if (erms < 0)
+	{
+		uint32_t eax, ebx, ecx, edx;
+
+		__asm__ volatile("cpuid"
+						 : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+						 : "a"(0));
+		if (eax >= 7)
+		{
+			__asm__ volatile("cpuid"
+							 : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+							 : "a"(7), "c"(0));
+			erms = (ebx >> 9) & 1;
+		}
+		else
+			erms = 0;
+	}
+	return erms;
+}
+
+/* Copies SIZE bytes forward from SRC to DST a word at a time,
+   finishing the tail byte by byte. */
+static void
+copy_fwd_words(unsigned char *dst, const unsigned char *src, size_t size)
+{
+	for (; size >= WORD_SIZE; size -= WORD_SIZE)
+	{
+		*(word_t *)dst = *(const word_t *)src;
+		dst += WORD_SIZE;
+		src += WORD_SIZE;
+	}
+	while (size-- > 0)
+		*dst++ = *src++;
+}
+
+/* Copies SIZE bytes backward from SRC to DST (that is, starting at
+   the last byte) a word at a time.  Safe for overlapping blocks with
+   DST > SRC. */
+static void
+copy_bwd_words(unsigned char *dst, const unsigned char *src, size_t size)
+{
+	dst += size;
+	src += size;
+	for (; size >= WORD_SIZE; size -= WORD_SIZE)
+	{
+		dst -= WORD_SIZE;
+		src -= WORD_SIZE;
+		*(word_t *)dst = *(const word_t *)src;
+	}
+	while (size-- > 0)
+		*--dst = *--src;
+}
+
+/* Copies SIZE bytes forward from SRC to DST using the string
+   instructions.  On ERMS parts a single `rep movsb' does the whole
+   job; otherwise the bulk moves with `rep movsq' and the remaining
+   0..7 bytes with `rep movsb'. */
+static void
+copy_fwd_rep(unsigned char *dst, const unsigned char *src, size_t size)
+{
+	if (has_erms())
+	{
+		__asm__ volatile("rep movsb"
+						 : "+D"(dst), "+S"(src), "+c"(size)
+						 :
+						 : "memory");
+		return;
+	}
+
+	size_t words = size / WORD_SIZE;
+	size_t tail = size % WORD_SIZE;
+
+	__asm__ volatile("rep movsq"
+					 : "+D"(dst), "+S"(src), "+c"(words)
+					 :
+					 : "memory");
+	__asm__ volatile("rep movsb"
+					 : "+D"(dst), "+S"(src), "+c"(tail)
+					 :
+					 : "memory");
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -13,8 +126,10 @@ void *memcpy(void *dst_, const void *src_, size_t size)
 	ASSERT(dst != NULL || size == 0);
 	ASSERT(src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
+	if (size < REP_THRESHOLD)
+		copy_fwd_words(dst, src, size);
+	else
+		copy_fwd_rep(dst, src, size);
 
 	return dst_;
 }
@@ -30,20 +145,19 @@ memmove(void *dst_, const void *src_, size_t size)
 	ASSERT(dst != NULL || size == 0);
 	ASSERT(src != NULL || size == 0);
 
-	if (dst < src)
-	{
-		while (size-- > 0)
-			*dst++ = *src++;
-	}
+	/* Blocks that do not overlap at all can take the memcpy() path.
+	   Otherwise copy a word at a time in the direction that never
+	   overwrites source bytes before they have been read: each word
+	   is loaded in full before it is stored, so a forward copy is safe
+	   whenever DST < SRC and a backward copy whenever DST > SRC. */
+	if (dst + size <= src || dst >= src + size)
+		memcpy(dst, src, size);
+	else if (dst < src)
+		copy_fwd_words(dst, src, size);
 	else
-	{
-		dst += size;
-		src += size;
-		while (size-- > 0)
-			*--dst = *--src;
-	}
+		copy_bwd_words(dst, src, size);
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +172,19 @@ int memcmp(const void *a_, const void *b_, size_t size)
 	ASSERT(a != NULL || size == 0);
 	ASSERT(b != NULL || size == 0);
 
+	/* Skip over equal words.  On the first word that differs, byte
+	   swapping both words puts the lowest-addressed byte in the most
+	   significant position, so an unsigned comparison orders them the
+	   same way a byte-by-byte scan would. */
+	for (; size >= WORD_SIZE; size -= WORD_SIZE, a += WORD_SIZE, b += WORD_SIZE)
+	{
+		uint64_t wa = *(const word_t *)a;
+		uint64_t wb = *(const word_t *)b;
+
+		if (wa != wb)
+			return __builtin_bswap64(wa) > __builtin_bswap64(wb) ? +1 : -1;
+	}
+
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -345,6 +472,32 @@ void *memset(void *dst_, int value, size_t size)
 
 	ASSERT(dst != NULL || size == 0);
 
+	if (size >= REP_THRESHOLD && has_erms())
+	{
+		__asm__ volatile("rep stosb"
+						 : "+D"(dst), "+c"(size)
+						 : "a"(value)
+						 : "memory");
+		return dst_;
+	}
+
+	/* Replicate VALUE into every byte of a word. */
+	uint64_t pattern = (unsigned char)value * ONES;
+
+	if (size >= REP_THRESHOLD)
+	{
+		size_t words = size / WORD_SIZE;
+
+		__asm__ volatile("rep stosq"
+						 : "+D"(dst), "+c"(words)
+						 : "a"(pattern)
+						 : "memory");
+		size %= WORD_SIZE;
+	}
+	else
+		for (; size >= WORD_SIZE; size -= WORD_SIZE, dst += WORD_SIZE)
+			*(word_t *)dst = pattern;
+
 	while (size-- > 0)
 		*dst++ = value;
 
@@ -359,7 +512,22 @@ strlen(const char *string)
 
 	ASSERT(string);
 
-	for (p = string; *p != '\0'; p++)
+	/* Walk byte by byte up to a word boundary, then test a whole
+	   aligned word per iteration.  An aligned word never straddles a
+	   page boundary, so reading past the terminator cannot fault. */
+	for (p = string; (uintptr_t)p % WORD_SIZE != 0; p++)
+		if (*p == '\0')
+			return p - string;
+
+	for (;; p += WORD_SIZE)
+	{
+		uint64_t w = *(const word_t *)p;
+
+		if (HAS_ZERO(w))
+			break;
+	}
+
+	for (; *p != '\0'; p++)
 		continue;
 	return p - string;
 }
@@ -59,7 +59,7 @@ __attribute__((always_inline)) static __inline int64_t syscall(uint64_t num_, ui
 			((uint64_t)ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-	syscall(((uint64_t *)NUMBER),                  \
+	syscall(((uint64_t)NUMBER),                    \
 			((uint64_t)ARG0),                      \
 			((uint64_t)ARG1),                      \
 			((uint64_t)ARG2),                      \
@@ -96,6 +96,11 @@ int exec(const char *file)
 	return (pid_t)syscall1(SYS_EXEC, file);
 }
 
+pid_t spawn(const char *cmd_line, const int fds[], size_t fd_cnt)
+{
+	return (pid_t)syscall3(SYS_SPAWN, cmd_line, fds, fd_cnt);
+}
+
 int wait(pid_t pid)
 {
 	return syscall1(SYS_WAIT, pid);
@@ -161,6 +166,36 @@ void munmap(void *addr)
 	syscall1(SYS_MUNMAP, addr);
 }
 
+int msync(void *addr, size_t length, int flags)
+{
+	return syscall3(SYS_MSYNC, addr, length, flags);
+}
+
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int pread(int fd, void *buffer, unsigned length, off_t offset)
+{
+	return syscall4(SYS_PREAD, fd, buffer, length, offset);
+}
+
+int pwrite(int fd, const void *buffer, unsigned length, off_t offset)
+{
+	return syscall4(SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int copy_file_range(int fd_in, int fd_out, unsigned length)
+{
+	return syscall3(SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
 bool chdir(const char *dir)
 {
 	return syscall1(SYS_CHDIR, dir);
@@ -0,0 +1,147 @@
+/* Test and benchmark for searching in lib/kernel/bitmap.c.
+
+   Fills bitmaps of several sizes with random runs of set and
+   unset bits, checks bitmap_scan(), bitmap_find_next() and the
+   next-fit scan against a bit-at-a-time reference, and prints
+   the cycles each implementation needs for the same searches.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Largest bitmap we test, in bits. */
+#define MAX_BITS 65536
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* The original bitmap_scan(): test every candidate start bit by
+   bit. */
+static size_t
+reference_scan (const struct bitmap *b, size_t start, size_t cnt,
+                bool value)
+{
+  size_t size = bitmap_size (b);
+
+  if (cnt <= size)
+    {
+      size_t last = size - cnt;
+      size_t i, j;
+
+      for (i = start; i <= last; i++)
+        {
+          for (j = 0; j < cnt; j++)
+            if (bitmap_test (b, i + j) != value)
+              break;
+          if (j == cnt)
+            return i;
+        }
+    }
+  return BITMAP_ERROR;
+}
+
+/* Fills B with runs of random length, mostly set, the way a
+   fragmented allocator's bitmap looks. */
+static void
+fill_runs (struct bitmap *b, int max_run)
+{
+  size_t size = bitmap_size (b);
+  size_t i = 0;
+
+  while (i < size)
+    {
+      size_t run = random_ulong () % max_run + 1;
+      bool value = random_ulong () % 4 != 0;
+
+      if (run > size - i)
+        run = size - i;
+      bitmap_set_multiple (b, i, run, value);
+      i += run;
+    }
+}
+
+void
+test (void)
+{
+  static const size_t cnts[] = {1, 3, 8, 32, 100};
+  size_t size;
+
+  random_init (0);
+  printf ("%6s %4s %12s %12s\n", "bits", "cnt", "ref cycles", "new cycles");
+
+  for (size = 64; size <= MAX_BITS; size *= 4)
+    {
+      struct bitmap *b = bitmap_create (size);
+      size_t c;
+
+      ASSERT (b != NULL);
+      fill_runs (b, 48);
+
+      for (c = 0; c < sizeof cnts / sizeof *cnts; c++)
+        {
+          size_t cnt = cnts[c];
+          uint64_t ref_cycles = 0, new_cycles = 0;
+          size_t start;
+
+          for (start = 0; start < size; start += size / 16)
+            {
+              uint64_t t0 = rdtsc ();
+              size_t expected = reference_scan (b, start, cnt, false);
+              uint64_t t1 = rdtsc ();
+              size_t actual = bitmap_scan (b, start, cnt, false);
+              uint64_t t2 = rdtsc ();
+
+              ASSERT (actual == expected);
+              ASSERT (reference_scan (b, start, cnt, true)
+                      == bitmap_scan (b, start, cnt, true));
+              ref_cycles += t1 - t0;
+              new_cycles += t2 - t1;
+            }
+          printf ("%6zu %4zu %12llu %12llu\n", size, cnt,
+                  (unsigned long long) ref_cycles,
+                  (unsigned long long) new_cycles);
+        }
+
+      /* find-first-zero and counting. */
+      for (c = 0; c < size; c += 7)
+        {
+          size_t expected = reference_scan (b, c, 1, false);
+          ASSERT (bitmap_find_next (b, c, false) == expected);
+          ASSERT (bitmap_contains (b, c, size - c, false)
+                  == (expected != BITMAP_ERROR));
+        }
+
+      /* Next-fit allocation hands out every free bit exactly once,
+         then fails. */
+      {
+        size_t cursor = 0;
+        size_t free_cnt = bitmap_count (b, 0, size, false);
+        size_t i;
+
+        for (i = 0; i < free_cnt; i++)
+          ASSERT (bitmap_scan_and_flip_next_fit (b, &cursor, 1, false)
+                  != BITMAP_ERROR);
+        ASSERT (bitmap_scan_next_fit (b, &cursor, 1, false)
+                == BITMAP_ERROR);
+        ASSERT (bitmap_all (b, 0, size));
+      }
+
+      bitmap_destroy (b);
+    }
+
+  printf ("done\n");
+}
@@ -0,0 +1,192 @@
+/* Benchmark for the hash tables in lib/kernel/hash.c.
+
+   Fills the chained table and the open-addressing table with the
+   same page-aligned keys at several load factors of the
+   open-addressing table, then reports how many successful and
+   unsuccessful lookups per second each of them manages.  Also
+   compares the throughput of hash_bytes() against the FNV-1
+   hash it replaced.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Slots in the open-addressing table once it stops growing. */
+#define SLOT_CNT 4096
+
+/* Lookups timed for each table and load factor. */
+#define LOOKUP_CNT (1 << 18)
+
+/* Bytes hashed by each hash function benchmark. */
+#define HASH_BUF_SIZE 4096
+#define HASH_ROUNDS 256
+
+/* An element of the chained table. */
+struct value {
+	struct hash_elem elem;      /* Hash element. */
+	uintptr_t key;              /* Key, a page address. */
+};
+
+static uint64_t value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
+static int64_t time_chained (struct hash *, size_t key_cnt, bool hit);
+static int64_t time_phash (struct phash *, size_t key_cnt, bool hit);
+static void bench_hash_bytes (void);
+
+static struct value values[SLOT_CNT];
+
+/* Returns the key of the Ith value inserted, which is present in
+   the tables if I is less than the number inserted.  The keys
+   look like the user page addresses the tables are meant for. */
+static uintptr_t
+key_of (size_t i) {
+	return 0x400000 + i * 4096;
+}
+
+/* Converts LOOKUP_CNT lookups in TICKS timer ticks into lookups
+   per second. */
+static unsigned long long
+per_sec (int64_t ticks) {
+	return (unsigned long long) LOOKUP_CNT * TIMER_FREQ
+		/ (ticks > 0 ? ticks : 1);
+}
+
+void
+test (void) {
+	static const unsigned loads[] = {25, 50, 75, 87};
+	size_t i;
+
+	printf ("%5s %14s %14s %14s %14s\n", "load", "chain hit/s",
+			"chain miss/s", "phash hit/s", "phash miss/s");
+	for (i = 0; i < sizeof loads / sizeof *loads; i++) {
+		size_t key_cnt = SLOT_CNT * loads[i] / 100;
+		struct hash chained;
+		struct phash open;
+		size_t k;
+
+		ASSERT (hash_init (&chained, value_hash, value_less, NULL));
+		phash_init (&open);
+
+		/* Grow the open-addressing table to its final size first,
+		   so the load factor is the one printed.  Tables never
+		   shrink. */
+		for (k = 0; k < SLOT_CNT * 7 / 8; k++)
+			ASSERT (phash_insert (&open, key_of (SLOT_CNT + k), &values[0]));
+		for (k = 0; k < SLOT_CNT * 7 / 8; k++)
+			ASSERT (phash_delete (&open, key_of (SLOT_CNT + k)) != NULL);
+
+		for (k = 0; k < key_cnt; k++) {
+			values[k].key = key_of (k);
+			ASSERT (hash_insert (&chained, &values[k].elem) == NULL);
+			ASSERT (phash_insert (&open, values[k].key, &values[k]));
+		}
+		ASSERT (open.cur.slot_cnt == SLOT_CNT);
+
+		printf ("%4u%% %14llu %14llu %14llu %14llu\n", loads[i],
+				per_sec (time_chained (&chained, key_cnt, true)),
+				per_sec (time_chained (&chained, key_cnt, false)),
+				per_sec (time_phash (&open, key_cnt, true)),
+				per_sec (time_phash (&open, key_cnt, false)));
+
+		hash_destroy (&chained, NULL);
+		phash_destroy (&open, NULL, NULL);
+	}
+
+	bench_hash_bytes ();
+	printf ("hash: done\n");
+}
+
+/* Times LOOKUP_CNT lookups in H of keys that are present, if HIT
+   is true, or absent otherwise.  Returns the elapsed ticks. */
+static int64_t
+time_chained (struct hash *h, size_t key_cnt, bool hit) {
+	struct value probe;
+	int64_t start = timer_ticks ();
+	size_t i;
+
+	for (i = 0; i < LOOKUP_CNT; i++) {
+		size_t k = i % key_cnt;
+
+		probe.key = key_of (hit ? k : key_cnt + k);
+		ASSERT ((hash_find (h, &probe.elem) != NULL) == hit);
+	}
+	return timer_elapsed (start);
+}
+
+/* Like time_chained(), for open-addressing table H. */
+static int64_t
+time_phash (struct phash *h, size_t key_cnt, bool hit) {
+	int64_t start = timer_ticks ();
+	size_t i;
+
+	for (i = 0; i < LOOKUP_CNT; i++) {
+		size_t k = i % key_cnt;
+
+		ASSERT ((phash_find (h, key_of (hit ? k : key_cnt + k)) != NULL)
+				== hit);
+	}
+	return timer_elapsed (start);
+}
+
+/* Fowler-Noll-Vo hash of the SIZE bytes in BUF, as hash_bytes()
+   computed it before. */
+static uint64_t
+fnv_bytes (const void *buf_, size_t size) {
+	const unsigned char *buf = buf_;
+	uint64_t hash = 0xcbf29ce484222325UL;
+
+	while (size-- > 0)
+		hash = (hash * 0x00000100000001B3UL) ^ *buf++;
+	return hash;
+}
+
+/* Reports the throughput of hash_bytes() and fnv_bytes(). */
+static void
+bench_hash_bytes (void) {
+	unsigned char *buf = malloc (HASH_BUF_SIZE);
+	uint64_t sum = 0;
+	int64_t start, fnv_ticks, murmur_ticks;
+	size_t i;
+
+	ASSERT (buf != NULL);
+	random_bytes (buf, HASH_BUF_SIZE);
+
+	start = timer_ticks ();
+	for (i = 0; i < HASH_ROUNDS; i++)
+		sum += fnv_bytes (buf, HASH_BUF_SIZE);
+	fnv_ticks = timer_elapsed (start);
+
+	start = timer_ticks ();
+	for (i = 0; i < HASH_ROUNDS; i++)
+		sum += hash_bytes (buf, HASH_BUF_SIZE);
+	murmur_ticks = timer_elapsed (start);
+
+	printf ("hash_bytes: %lld ticks for %d KiB, FNV: %lld ticks (%llx)\n",
+			(long long) murmur_ticks, HASH_BUF_SIZE * HASH_ROUNDS / 1024,
+			(long long) fnv_ticks, (unsigned long long) sum);
+	free (buf);
+}
+
+static uint64_t
+value_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_ptr (hash_entry (e, struct value, elem)->key);
+}
+
+static bool
+value_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct value *a = hash_entry (a_, struct value, elem);
+	const struct value *b = hash_entry (b_, struct value, elem);
+
+	return a->key < b->key;
+}
@@ -0,0 +1,112 @@
+/* Test for the LZ77 block compressor in lib/kernel/lz.c.
+
+   Compresses pages of several kinds of content, from all zeros to
+   random bytes, checks that each decompresses to the original and
+   that truncated or oversized outputs are rejected, and prints the
+   compressed size of each kind.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Kinds of page content. */
+enum content {
+	ZEROS,                      /* All zeros. */
+	SPARSE,                     /* Zeros with a few scattered words. */
+	TEXT,                       /* Words from a small vocabulary. */
+	RANDOM,                     /* Random bytes. */
+	CONTENT_CNT
+};
+
+static const char *const content_names[CONTENT_CNT] = {
+	"zeros", "sparse", "text", "random",
+};
+
+static void fill (uint8_t *page, enum content);
+
+void
+test (void) {
+	uint8_t *in = palloc_get_page (PAL_ASSERT);
+	uint8_t *out = palloc_get_page (PAL_ASSERT);
+	uint8_t *back = palloc_get_page (PAL_ASSERT);
+	uint8_t work[LZ_WORK_SIZE];
+	int kind;
+
+	random_init (0);
+	for (kind = 0; kind < CONTENT_CNT; kind++) {
+		size_t len = lz_compress (in, 0, out, PGSIZE, work);
+
+		/* Empty input is a single empty run. */
+		ASSERT (len == 1 && lz_decompress (out, len, back, 0));
+
+		fill (in, kind);
+		len = lz_compress (in, PGSIZE, out, PGSIZE, work);
+		if (len == 0) {
+			ASSERT (kind == RANDOM);
+			printf ("%8s: incompressible\n", content_names[kind]);
+			continue;
+		}
+
+		memset (back, 0, PGSIZE);
+		ASSERT (lz_decompress (out, len, back, PGSIZE));
+		ASSERT (!memcmp (in, back, PGSIZE));
+		ASSERT (!lz_decompress (out, len, back, PGSIZE - 1));
+		ASSERT (!lz_decompress (out, len - 1, back, PGSIZE));
+
+		/* A limit just below the size needed must fail. */
+		ASSERT (lz_compress (in, PGSIZE, out, len - 1, work) == 0);
+
+		printf ("%8s: %4zu bytes\n", content_names[kind], len);
+	}
+
+	palloc_free_page (in);
+	palloc_free_page (out);
+	palloc_free_page (back);
+	printf ("lz: done\n");
+}
+
+/* Fills PAGE with content of kind KIND. */
+static void
+fill (uint8_t *page, enum content kind) {
+	static const char *const words[] = {
+		"page ", "frame ", "swap ", "slot ", "the ", "of ", "a ",
+	};
+	size_t i, n;
+
+	switch (kind) {
+		case ZEROS:
+			memset (page, 0, PGSIZE);
+			break;
+		case SPARSE:
+			memset (page, 0, PGSIZE);
+			for (i = 0; i < PGSIZE; i += 256)
+				*(uint32_t *) (page + i) = random_ulong ();
+			break;
+		case TEXT:
+			for (i = 0; i < PGSIZE; i += n) {
+				const char *w = words[random_ulong () % 7];
+
+				n = strlen (w);
+				if (n > PGSIZE - i)
+					n = PGSIZE - i;
+				memcpy (page + i, w, n);
+			}
+			break;
+		case RANDOM:
+			random_bytes (page, PGSIZE);
+			break;
+		default:
+			NOT_REACHED ();
+	}
+}
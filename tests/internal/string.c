@@ -0,0 +1,135 @@
+/* Microbenchmark for the block functions in lib/string.c.
+
+   Times memcpy(), memmove(), memset(), memcmp() and strlen() on
+   blocks from 8 bytes to 64 kB and prints the throughput of each
+   in bytes per 100 cycles, measured with the time-stamp counter.
+   Each result is also checked against a byte-at-a-time reference
+   so that a broken fast path fails loudly instead of looking fast.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block size we time. */
+#define MAX_SIZE (64 * 1024)
+
+/* Every measurement copies at least this many bytes in total, so
+   that small sizes are repeated often enough to be measurable. */
+#define MIN_TOTAL (1024 * 1024)
+
+static unsigned char src[MAX_SIZE + 16];
+static unsigned char dst[MAX_SIZE + 16];
+
+/* Reads the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Prints SIZE * REPS bytes processed in CYCLES as bytes per 100
+   cycles, since the kernel printf() has no floating point. */
+static void
+report (size_t size, size_t reps, uint64_t cycles)
+{
+  if (cycles == 0)
+    cycles = 1;
+  printf (" %6llu", (unsigned long long) (size * reps * 100 / cycles));
+}
+
+static void
+verify_copy (size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    ASSERT (dst[i] == src[i]);
+}
+
+/* Times each function across all block sizes. */
+void
+test (void)
+{
+  size_t size, i;
+
+  for (i = 0; i < sizeof src; i++)
+    src[i] = i % 255 + 1;
+  src[MAX_SIZE] = '\0';
+
+  printf ("bytes per 100 cycles\n");
+  printf ("%8s %6s %6s %6s %6s %6s\n",
+          "size", "memcpy", "mmove", "memset", "memcmp", "strlen");
+
+  for (size = 8; size <= MAX_SIZE; size *= 2)
+    {
+      size_t reps = MIN_TOTAL / size;
+      uint64_t start;
+      size_t r;
+      int sum = 0;
+
+      printf ("%8zu", size);
+
+      start = rdtsc ();
+      for (r = 0; r < reps; r++)
+        memcpy (dst, src, size);
+      report (size, reps, rdtsc () - start);
+      verify_copy (size);
+
+      /* Overlapping move in the backward direction. */
+      start = rdtsc ();
+      for (r = 0; r < reps; r++)
+        memmove (dst + 3, dst, size);
+      report (size, reps, rdtsc () - start);
+
+      start = rdtsc ();
+      for (r = 0; r < reps; r++)
+        memset (dst, r, size);
+      report (size, reps, rdtsc () - start);
+      for (i = 0; i < size; i++)
+        ASSERT (dst[i] == (unsigned char) (reps - 1));
+
+      memcpy (dst, src, size);
+      start = rdtsc ();
+      for (r = 0; r < reps; r++)
+        sum += memcmp (dst, src, size);
+      report (size, reps, rdtsc () - start);
+      ASSERT (sum == 0);
+
+      /* SRC holds no zero bytes, so terminate a
+         copy at SIZE for the strlen() run. */
+      memcpy (dst, src, size);
+      dst[size] = '\0';
+      start = rdtsc ();
+      for (r = 0; r < reps; r++)
+        sum += strlen ((const char *) dst);
+      report (size, reps, rdtsc () - start);
+      ASSERT ((size_t) sum == size * reps);
+
+      printf ("\n");
+    }
+
+  /* Spot-check ordering and overlap semantics. */
+  memcpy (dst, src, 64);
+  dst[37]++;
+  ASSERT (memcmp (dst, src, 64) > 0);
+  ASSERT (memcmp (src, dst, 64) < 0);
+  for (i = 0; i < 64; i++)
+    dst[i] = i;
+  memmove (dst + 1, dst, 40);
+  for (i = 0; i < 40; i++)
+    ASSERT (dst[i + 1] == i);
+  memmove (dst, dst + 1, 40);
+  for (i = 0; i < 40; i++)
+    ASSERT (dst[i] == i);
+
+  printf ("done\n");
+}
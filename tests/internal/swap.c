@@ -0,0 +1,131 @@
+/* Benchmark for the multi-sector transfers in devices/disk.c that
+   back the swap space.
+
+   Writes and then reads back BENCH_PAGES pages on the swap disk
+   (hd1:1), first one sector per disk command, as swapping did with
+   disk_write(), and then with disk_write_sectors() and
+   disk_read_sectors() moving one page and one swap cluster per
+   command.  Reports the throughput of each in MiB/s and checks
+   that the data read back is what was written.
+
+   Overwrites the start of the swap disk, so it must run before any
+   user process.  This is not a test we will run on your submitted
+   projects.  It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
+
+/* Pages moved by each run. */
+#define BENCH_PAGES 256
+
+/* Pages in a swap cluster, as in vm/anon.c. */
+#define CLUSTER_PAGES 8
+
+#define PAGE_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+static int64_t run (struct disk *, uint8_t *pages, size_t batch_pages,
+                    bool write);
+static void fill (uint8_t *pages, size_t salt);
+static void print_rate (const char *name, int64_t write_ticks,
+                        int64_t read_ticks);
+
+void
+test (void) {
+	static const struct {
+		const char *name;
+		size_t batch_pages;         /* Pages per command, 0 for one sector. */
+	} modes[] = {
+		{"sector", 0},
+		{"page", 1},
+		{"cluster", CLUSTER_PAGES},
+	};
+	struct disk *d = disk_get (1, 1);
+	uint8_t *pages;
+	size_t i;
+
+	if (d == NULL || disk_size (d) < BENCH_PAGES * PAGE_SECTORS) {
+		printf ("swap: no swap disk large enough, skipping\n");
+		return;
+	}
+	pages = palloc_get_multiple (PAL_ASSERT, BENCH_PAGES * 2);
+
+	printf ("%8s %12s %12s\n", "mode", "write MiB/s", "read MiB/s");
+	for (i = 0; i < sizeof modes / sizeof *modes; i++) {
+		uint8_t *back = pages + BENCH_PAGES * PGSIZE;
+		int64_t write_ticks, read_ticks;
+
+		fill (pages, i);
+		memset (back, 0, BENCH_PAGES * PGSIZE);
+		write_ticks = run (d, pages, modes[i].batch_pages, true);
+		read_ticks = run (d, back, modes[i].batch_pages, false);
+		ASSERT (!memcmp (pages, back, BENCH_PAGES * PGSIZE));
+		print_rate (modes[i].name, write_ticks, read_ticks);
+	}
+
+	palloc_free_multiple (pages, BENCH_PAGES * 2);
+	printf ("swap: done\n");
+}
+
+/* Writes PAGES to the start of D, or reads them back if WRITE is
+   false, BATCH_PAGES pages per disk command or one sector per
+   command if BATCH_PAGES is 0.  Returns the elapsed ticks. */
+static int64_t
+run (struct disk *d, uint8_t *pages, size_t batch_pages, bool write) {
+	void *sectors[CLUSTER_PAGES * PAGE_SECTORS];
+	size_t batch = batch_pages > 0 ? batch_pages * PAGE_SECTORS : 1;
+	int64_t start = timer_ticks ();
+	size_t sec, i;
+
+	ASSERT (batch <= sizeof sectors / sizeof *sectors);
+	for (sec = 0; sec < BENCH_PAGES * PAGE_SECTORS; sec += batch) {
+		uint8_t *buf = pages + sec * DISK_SECTOR_SIZE;
+
+		if (batch_pages == 0) {
+			if (write)
+				disk_write (d, sec, buf);
+			else
+				disk_read (d, sec, buf);
+			continue;
+		}
+		for (i = 0; i < batch; i++)
+			sectors[i] = buf + i * DISK_SECTOR_SIZE;
+		if (write)
+			disk_write_sectors (d, sec, batch,
+					(const void *const *) sectors);
+		else
+			disk_read_sectors (d, sec, batch, sectors);
+	}
+	return timer_elapsed (start);
+}
+
+/* Fills PAGES with a pattern that depends on SALT. */
+static void
+fill (uint8_t *pages, size_t salt) {
+	size_t i;
+
+	for (i = 0; i < BENCH_PAGES * PGSIZE; i++)
+		pages[i] = (uint8_t) (i * 31 + salt + (i >> 12));
+}
+
+/* Prints the throughput of moving BENCH_PAGES pages in WRITE_TICKS
+   and READ_TICKS timer ticks, in hundredths of MiB/s. */
+static void
+print_rate (const char *name, int64_t write_ticks, int64_t read_ticks) {
+	const unsigned long long bytes = (unsigned long long) BENCH_PAGES * PGSIZE;
+	unsigned long long w, r;
+
+	w = bytes * 100 * TIMER_FREQ / (write_ticks > 0 ? write_ticks : 1)
+		/ (1024 * 1024);
+	r = bytes * 100 * TIMER_FREQ / (read_ticks > 0 ? read_ticks : 1)
+		/ (1024 * 1024);
+	printf ("%8s %9llu.%02llu %9llu.%02llu\n", name,
+			w / 100, w % 100, r / 100, r % 100);
+}
@@ -0,0 +1,65 @@
+/* Benchmark for copying a file.  Creates a file of SIZE bytes,
+   then copies it ITERS times into a second file, either with a
+   loop of read() and write() through a user buffer or with a
+   single copy_file_range().  Run it as
+   "copy-bench MODE SIZE ITERS", with MODE "rw" or "copy", and
+   compare the "Timer: N ticks" lines the kernel prints at power
+   off. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Size of the user buffer for the read and write loop. */
+#define BUF_SIZE 4096
+
+static char buf[BUF_SIZE];
+
+const char *test_name = "copy-bench";
+
+int
+main (int argc, char *argv[]) 
+{
+  bool use_copy;
+  int size, iters, in, out;
+
+  if (argc != 4)
+    fail ("usage: copy-bench rw|copy SIZE ITERS");
+  use_copy = !strcmp (argv[1], "copy");
+  size = atoi (argv[2]);
+  iters = atoi (argv[3]);
+
+  if (!create ("bench-in", size) || !create ("bench-out", size))
+    fail ("create failed");
+  if ((in = open ("bench-in")) < 2 || (out = open ("bench-out")) < 2)
+    fail ("open failed");
+
+  memset (buf, 'x', sizeof buf);
+  for (int ofs = 0; ofs < size; ofs += BUF_SIZE)
+    write (in, buf, size - ofs < BUF_SIZE ? size - ofs : BUF_SIZE);
+
+  for (int i = 0; i < iters; i++) 
+    {
+      int copied = 0;
+
+      seek (in, 0);
+      seek (out, 0);
+      if (use_copy)
+        copied = copy_file_range (in, out, size);
+      else
+        for (;;)
+          {
+            int n = read (in, buf, BUF_SIZE);
+            if (n <= 0 || write (out, buf, n) != n)
+              break;
+            copied += n;
+          }
+      if (copied != size)
+        fail ("copy %d moved %d of %d bytes", i, copied, size);
+    }
+
+  msg ("%d copies of %d bytes with %s",
+       iters, size, use_copy ? "copy_file_range" : "read+write");
+  return 0;
+}
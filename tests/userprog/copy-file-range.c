@@ -0,0 +1,46 @@
+/* Copies part of one file into another with copy_file_range,
+   which must advance both file positions, and checks the
+   copied data and the error cases. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 6000
+
+static char data[FILE_SIZE];
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int in, out;
+
+  for (int i = 0; i < FILE_SIZE; i++)
+    data[i] = i % 251;
+
+  CHECK (create ("in", FILE_SIZE), "create \"in\"");
+  CHECK (create ("out", FILE_SIZE), "create \"out\"");
+  CHECK ((in = open ("in")) > 1, "open \"in\"");
+  CHECK ((out = open ("out")) > 1, "open \"out\"");
+  CHECK (write (in, data, FILE_SIZE) == FILE_SIZE, "write \"in\"");
+
+  seek (in, 100);
+  seek (out, 512);
+  CHECK (copy_file_range (in, out, 5000) == 5000, "copy 5000 bytes");
+  CHECK (tell (in) == 5100, "tell \"in\" after copy");
+  CHECK (tell (out) == 5512, "tell \"out\" after copy");
+  CHECK (pread (out, buf, 5000, 512) == 5000, "read back \"out\"");
+  if (memcmp (buf, data + 100, 5000))
+    fail ("data copied differ from data written");
+
+  CHECK (copy_file_range (in, out, 5000) == FILE_SIZE - 5512,
+         "copy to end of \"out\"");
+
+  seek (in, 0);
+  seek (out, 0);
+  CHECK (copy_file_range (in, in, 100) == -1, "copy onto itself");
+  CHECK (copy_file_range (in, 1, 100) == -1, "copy to stdout");
+  CHECK (copy_file_range (in, 1234, 100) == -1, "copy to bad fd");
+}
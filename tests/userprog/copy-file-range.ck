@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "in"
+(copy-file-range) create "out"
+(copy-file-range) open "in"
+(copy-file-range) open "out"
+(copy-file-range) write "in"
+(copy-file-range) copy 5000 bytes
+(copy-file-range) tell "in" after copy
+(copy-file-range) tell "out" after copy
+(copy-file-range) read back "out"
+(copy-file-range) copy to end of "out"
+(copy-file-range) copy onto itself
+(copy-file-range) copy to stdout
+(copy-file-range) copy to bad fd
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Writes and reads a file at given positions with pwrite and
+   pread, which must leave the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[3];
+  int handle;
+
+  CHECK (create ("data", 512), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+
+  CHECK (pwrite (handle, "xyz", 3, 100) == 3, "pwrite at 100");
+  CHECK (tell (handle) == 0, "tell after pwrite");
+  CHECK (pread (handle, buf, 3, 100) == 3, "pread at 100");
+  CHECK (tell (handle) == 0, "tell after pread");
+  if (memcmp (buf, "xyz", 3))
+    fail ("data read differ from data written");
+
+  CHECK (pread (handle, buf, 3, 512) == 0, "pread at end of file");
+  CHECK (pwrite (handle, "xyz", 3, -1) == -1, "pwrite at negative offset");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "data"
+(pread-pwrite) open "data"
+(pread-pwrite) pwrite at 100
+(pread-pwrite) tell after pwrite
+(pread-pwrite) pread at 100
+(pread-pwrite) tell after pread
+(pread-pwrite) pread at end of file
+(pread-pwrite) pwrite at negative offset
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
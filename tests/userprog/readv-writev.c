@@ -0,0 +1,37 @@
+/* Writes a record of three fields to a file with a single writev
+   and reads them back into three buffers with a single readv.
+   Then writes a line to the console with writev. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char name[5], sep[2], city[7];
+  struct iovec out[3] = {
+    {(void *) "alice", 5}, {(void *) ", ", 2}, {(void *) "daejeon", 7},
+  };
+  struct iovec in[3] = {{name, 5}, {sep, 2}, {city, 7}};
+  struct iovec line[3] = {
+    {(void *) "(readv-writev) ", 15}, {(void *) "console ", 8},
+    {(void *) "line\n", 5},
+  };
+  int handle;
+
+  CHECK (create ("record", 14), "create \"record\"");
+  CHECK ((handle = open ("record")) > 1, "open \"record\"");
+  CHECK (writev (handle, out, 3) == 14, "writev 3 fields");
+  CHECK (tell (handle) == 14, "tell after writev");
+
+  seek (handle, 0);
+  CHECK (readv (handle, in, 3) == 14, "readv 3 fields");
+  CHECK (tell (handle) == 14, "tell after readv");
+  if (memcmp (name, "alice", 5) || memcmp (sep, ", ", 2)
+      || memcmp (city, "daejeon", 7))
+    fail ("fields read differ from fields written");
+
+  CHECK (writev (1, line, 3) == 28, "writev to console");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "record"
+(readv-writev) open "record"
+(readv-writev) writev 3 fields
+(readv-writev) tell after writev
+(readv-writev) readv 3 fields
+(readv-writev) tell after readv
+(readv-writev) console line
+(readv-writev) writev to console
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
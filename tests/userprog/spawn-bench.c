@@ -0,0 +1,55 @@
+/* Benchmark for starting child processes.  Touches PAGES pages
+   of memory, then starts and waits for ITERS children running
+   child-simple, either with fork() followed by exec() or with
+   spawn().  Run it as "spawn-bench MODE PAGES ITERS", with MODE
+   "fork" or "spawn", for a few sizes of the parent, and compare
+   the "Timer: N ticks" lines the kernel prints at power off. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Most pages the parent touches. */
+#define MAX_PAGES 256
+
+static char pages[MAX_PAGES][4096];
+
+const char *test_name = "spawn-bench";
+
+int
+main (int argc, char *argv[]) 
+{
+  bool use_spawn;
+  int page_cnt, iters;
+
+  if (argc != 4)
+    fail ("usage: spawn-bench fork|spawn PAGES ITERS");
+  use_spawn = !strcmp (argv[1], "spawn");
+  page_cnt = atoi (argv[2]);
+  iters = atoi (argv[3]);
+  if (page_cnt > MAX_PAGES)
+    page_cnt = MAX_PAGES;
+
+  for (int i = 0; i < page_cnt; i++)
+    memset (pages[i], i, sizeof pages[i]);
+
+  for (int i = 0; i < iters; i++) 
+    {
+      pid_t pid;
+
+      if (use_spawn)
+        pid = spawn ("child-simple", NULL, 0);
+      else if ((pid = fork ("child-simple")) == 0)
+        {
+          exec ("child-simple");
+          exit (-1);
+        }
+      if (wait (pid) != 81)
+        fail ("child %d failed", i);
+    }
+
+  msg ("%d children started with %s from %d pages",
+       iters, use_spawn ? "spawn" : "fork+exec", page_cnt);
+  return 0;
+}
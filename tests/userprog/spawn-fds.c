@@ -0,0 +1,23 @@
+/* Opens a file and spawns a child process that gets the file
+   as descriptor 5 and closes it.  The parent's own descriptor
+   must still work afterward. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int fds[6] = {0, 1, -1, -1, -1, -1};
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  fds[5] = handle;
+
+  msg ("wait(spawn()) = %d", wait (spawn ("child-close 5", fds, 6)));
+
+  check_file_handle (handle, "sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-fds) begin
+(spawn-fds) open "sample.txt"
+(child-close) begin
+(child-close) verified contents of "sample.txt"
+(child-close) end
+child-close: exit(0)
+(spawn-fds) wait(spawn()) = 0
+(spawn-fds) verified contents of "sample.txt"
+(spawn-fds) end
+spawn-fds: exit(0)
+EOF
+pass;
@@ -0,0 +1,14 @@
+/* Spawns a single child process, without forking first, and
+   waits for it.  Then tries to spawn a nonexistent program,
+   which must fail. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("wait(spawn()) = %d", wait (spawn ("child-simple", NULL, 0)));
+  msg ("spawn(\"no-such-file\") = %d", spawn ("no-such-file", NULL, 0));
+}
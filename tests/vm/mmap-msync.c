@@ -0,0 +1,47 @@
+/* Writes to a file through a mapping and writes the mapping back
+   with msync(), then reads the data in the file back using the
+   read system call while the mapping is still in place. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  static const char overwrite[] = "Now is the time for all good...";
+  int handle;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (ACTUAL, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+
+  /* Write back synchronously. */
+  memcpy (ACTUAL, sample, strlen (sample));
+  CHECK (msync (ACTUAL, 4096, MS_SYNC) == 0, "msync \"sample.txt\"");
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+
+  /* Only mapped memory can be written back. */
+  CHECK (msync (ACTUAL + 4096, 4096, MS_SYNC) == -1,
+         "try to msync unmapped memory");
+
+  /* Write back asynchronously; unmapping finishes the job. */
+  memcpy (ACTUAL, overwrite, strlen (overwrite));
+  CHECK (msync (ACTUAL, 4096, MS_ASYNC) == 0, "msync asynchronously");
+  munmap (ACTUAL);
+  seek (handle, 0);
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, overwrite, strlen (overwrite))
+         && !memcmp (buf + strlen (overwrite), sample + strlen (overwrite),
+                     strlen (sample) - strlen (overwrite)),
+         "compare read data against data written before munmap");
+  close (handle);
+}
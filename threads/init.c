@@ -31,6 +31,9 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/ksm.h"
+#include "vm/thp.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -86,6 +89,7 @@ int main(void)
 	mem_end = palloc_init(); // 페이지 할당기 초기화 하고 메모리 사이즈 return
 	malloc_init();			 // malloc descriptor return
 	paging_init(mem_end);	 // 페이징 함수 호출
+	pml4_pcid_init();		 // 지원되면 PCID로 문맥 전환 시 TLB 유지
 
 #ifdef USERPROG // USERPROG 매크로 등록 되어 있을 때 만
 	tss_init();
@@ -167,12 +171,35 @@ static void paging_init(uint64_t mem_end)
 
 	// 실제 주소 [0 ~ mem_end]를 다음과 같이 매핑합니다.
 	// [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE)
+
+	// Whole 2 MB chunks are mapped with a single large-page PDE,
+	// which saves the page tables and a TLB entry per 4 kB. Chunks
+	// overlapping kernel text, which must be read-only with 4 kB
+	// granularity, and the partial chunk at mem_end use small pages.
+	// 2MB 단위의 청크는 라지 페이지 PDE 하나로 매핑합니다.
+	uint64_t text_lo = (uint64_t)&start;
+	uint64_t text_hi = (uint64_t)&_end_kernel_text;
+
+	for (uint64_t pa = 0; pa < mem_end;)
 	{
 		uint64_t va = (uint64_t)ptov(pa);
 		int perm = PTE_P | PTE_W;
 
-		if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
+		if (lpg_ofs(pa) == 0 && pa + LPGSIZE <= mem_end &&
+			(va + LPGSIZE <= text_lo || va >= text_hi))
+		{
+			uint64_t *pde = pml4e_walk_pde(pml4, va, 1);
+
+			if (pde != NULL)
+			{
+				*pde = pa | perm | PTE_PS;
+			}
+
+			pa += LPGSIZE;
+			continue;
+		}
+
+		if (text_lo <= va && va < text_hi)
 		{
 			perm &= ~PTE_W;
 		}
@@ -183,6 +210,8 @@ static void paging_init(uint64_t mem_end)
 		{
 			*pte = pa | perm;
 		}
+
+		pa += PGSIZE;
 	}
 
 	// reload cr3
@@ -254,6 +283,22 @@ static char **parse_options(char **argv)
 			user_page_limit = atoi(value);
 		else if (!strcmp(name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp(name, "-zswap"))
+			zswap_max_percent = atoi(value);
+		else if (!strcmp(name, "-ksm"))
+			ksm_pages_per_pass = atoi(value);
+		else if (!strcmp(name, "-ksm-sleep"))
+			ksm_sleep_ms = atoi(value);
+		else if (!strcmp(name, "-thp"))
+			thp_enabled = true;
+		else if (!strcmp(name, "-thp-sleep"))
+			thp_sleep_ms = atoi(value);
+		else if (!strcmp(name, "-rss-soft"))
+			rss_soft_limit = atoi(value);
+		else if (!strcmp(name, "-rss-hard"))
+			rss_hard_limit = atoi(value);
 #endif
 		else
 			PANIC("unknown option `%s' (use -h for help)", name);
@@ -365,6 +410,20 @@ static void usage(void)
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+		   "  -zswap=PERCENT     Compress swapped pages in up to PERCENT%%\n"
+		   "                     of kernel memory, at most 50, before using\n"
+		   "                     the swap disk.\n"
+		   "  -ksm=PAGES         Merge identical anonymous pages, scanning\n"
+		   "                     PAGES pages per pass.\n"
+		   "  -ksm-sleep=MS      Sleep MS milliseconds between ksm passes.\n"
+		   "  -thp               Map 2 MB anonymous regions with large pages.\n"
+		   "  -thp-sleep=MS      Sleep MS milliseconds between khugepaged\n"
+		   "                     passes.\n"
+		   "  -rss-soft=PAGES    Evict first from processes with more than\n"
+		   "                     PAGES resident pages.\n"
+		   "  -rss-hard=PAGES    Keep each process to PAGES resident pages.\n"
 #endif
 	);
 	power_off();
@@ -376,6 +435,11 @@ static void usage(void)
    (Bochs 또는 QEMU에서 실행 중인 경우) */
 void power_off(void)
 {
+#ifdef VM
+	/* Not after a panic, which leaves interrupts off. */
+	if (intr_get_level() == INTR_ON)
+		file_writeback_sync(NULL);
+#endif
 #ifdef FILESYS
 	filesys_done();
 #endif
@@ -403,4 +467,11 @@ static void print_stats(void)
 #ifdef USERPROG
 	exception_print_stats();
 #endif
+#ifdef VM
+	anon_print_stats();
+	zswap_print_stats();
+	ksm_print_stats();
+	thp_print_stats();
+	vm_print_stats();
+#endif
 }
@@ -27,6 +27,10 @@ static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 			else
 				return NULL;
 		}
+		/* A large page is mapped by the PDE itself, which then
+		 * serves as the "PTE" for every address inside it. */
+		if (pdp[idx] & PTE_PS)
+			return &pdp[idx];
 		return (uint64_t *)ptov(PTE_ADDR(pdp[idx]) + 8 * PTX(va));
 	}
 	return NULL;
@@ -71,7 +75,9 @@ static uint64_t *pdpe_walk(uint64_t *pdpe, const uint64_t va, int create)
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR lies inside a 2 MB large page, the returned entry is
+ * the page directory entry that maps it (PTE_PS is set). */
 /* 페이지 맵 레벨 4, pml4의 가상 주소 VADDR에 대한 페이지 테이블
  * 항목의 주소를 반환합니다. PML4E에 VADDR에 대한 페이지 테이블이
  * 없는 경우, 동작은 CREATE에 따라 달라집니다. CREATE가 참이면 새
@@ -111,6 +117,41 @@ uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create)
 	return pte;
 }
 
+/* Returns the address of the page directory entry that covers
+ * virtual address VA in PML4, creating the intermediate page map
+ * level 4 and page directory pointer tables if CREATE is true.
+ * Unlike pml4e_walk(), this never descends to (or allocates) a
+ * page table, so the result can be used to install a large page.
+ * Returns a null pointer if a table is missing and CREATE is false,
+ * or if memory allocation fails. */
+/* PML4에서 가상 주소 VA를 다루는 페이지 디렉터리 항목의 주소를
+ * 반환합니다. 페이지 테이블까지 내려가지 않으므로 라지 페이지를
+ * 설치하는 데 사용할 수 있습니다. */
+uint64_t *pml4e_walk_pde(uint64_t *pml4, const uint64_t va, int create)
+{
+	uint64_t *table = pml4;
+	int idx[2] = {PML4(va), PDPE(va)};
+
+	if (pml4 == NULL)
+		return NULL;
+
+	for (int level = 0; level < 2; level++)
+	{
+		uint64_t *entry = &table[idx[level]];
+
+		if (!(*entry & PTE_P))
+		{
+			uint64_t *new_page;
+
+			if (!create || (new_page = palloc_get_page(PAL_ZERO)) == NULL)
+				return NULL;
+			*entry = vtop(new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov(PTE_ADDR(*entry));
+	}
+	return &table[PDX(va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -155,10 +196,20 @@ static bool pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux,
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
-			if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
-							 pml4_index, pdp_index, i))
+		if (!(((uint64_t)pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS)
+		{
+			/* Large page: visit its PDE once, at the 2 MB base. */
+			void *va = (void *)(((uint64_t)pml4_index << PML4SHIFT) |
+								((uint64_t)pdp_index << PDPESHIFT) |
+								((uint64_t)i << PDXSHIFT));
+			if (!func(&pdp[i], va, aux))
 				return false;
+		}
+		else if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
+							  pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -177,7 +228,10 @@ static bool pdp_for_each(uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * A 2 MB large page is visited once, with the PDE that maps it as
+ * the PTE and its 2 MB-aligned base as VA; use is_large_pte() to
+ * tell the two apart. */
 /* 커널을 포함하여 사용 가능한 각 pte 항목에 FUNC를 적용합니다. */
 bool pml4_for_each(uint64_t *pml4, pte_for_each_func *func, void *aux)
 {
@@ -207,7 +261,11 @@ static void pgdir_destroy(uint64_t *pdp)
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		if (!(((uint64_t)pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS)
+			palloc_free_multiple((void *)LPTE_ADDR(pte), LPG_PAGES);
+		else
 			pt_destroy(PTE_ADDR(pte));
 	}
 	palloc_free_page((void *)pdp);
@@ -240,13 +298,318 @@ void pml4_destroy(uint64_t *pml4)
 	palloc_free_page((void *)pml4);
 }
 
+/* Process-context identifiers (PCIDs).
+ *
+ * With CR4.PCIDE set, the TLB tags each entry with the 12-bit PCID
+ * in the low bits of CR3, and a CR3 load with CR3_NOFLUSH set keeps
+ * the entries of every PCID.  Switching between processes then no
+ * longer flushes the whole TLB.
+ *
+ * PCIDs 1 to PCID_CNT - 1 are handed out to page map level 4s in
+ * order as they are activated.  When they run out, a new generation
+ * starts: every PCID is flushed and each pml4 gets a fresh PCID the
+ * next time it is activated.  Within a generation a PCID is never
+ * reused, so a newly assigned one has no stale entries.  PCID 0
+ * belongs to base_pml4, which maps only the kernel.
+ *
+ * A pml4's PCID and the generation it belongs to are stored in its
+ * last entry, PCID_SLOT, with the present bit clear so that the MMU
+ * ignores it.  That entry would map the top 512 GB of the virtual
+ * address space, which Pintos never uses, and pml4_create() copies
+ * it as zero ("no PCID") from base_pml4. */
+/* 프로세스 컨텍스트 식별자(PCID). CR4.PCIDE가 설정되면 TLB 항목이
+ * PCID로 태그되므로 프로세스 간 전환 시 전체 TLB를 비우지 않습니다. */
+#define CR4_PCIDE (1UL << 17)  /* CR4: enable PCIDs. */
+#define CR3_NOFLUSH (1UL << 63) /* CR3 load: keep TLB entries. */
+#define CR3_PCID_MASK 0xfffUL  /* CR3: PCID bits. */
+#define PCID_CNT 4096
+#define PCID_SLOT 511
+#define PCID_TAG(GEN, PCID) (((uint64_t)(GEN) << 13) | ((uint64_t)(PCID) << 1))
+#define PCID_TAG_GEN(TAG) ((TAG) >> 13)
+#define PCID_TAG_PCID(TAG) (((TAG) >> 1) & (PCID_CNT - 1))
+
+#define INVPCID_ADDR 0 /* One address in one PCID. */
+#define INVPCID_ALL 2  /* Everything in every PCID. */
+
+static bool pcid_enabled;	   /* CR4.PCIDE is set. */
+static bool invpcid_supported; /* CPU has the INVPCID instruction. */
+static uint64_t pcid_gen = 1;  /* Current generation; 0 is never valid. */
+static unsigned next_pcid = 1; /* Next PCID to hand out. */
+
+/* Turns on PCIDs if the CPU supports them.  Must be called with
+ * base_pml4 active, after paging_init(). */
+/* CPU가 지원하면 PCID를 켭니다. */
+void pml4_pcid_init(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & (1 << 17)))
+		return;
+
+	cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7)
+	{
+		cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+		invpcid_supported = (ebx & (1 << 10)) != 0;
+	}
+
+	/* CR4.PCIDE may only be set while CR3 holds PCID 0. */
+	ASSERT((rcr3() & CR3_PCID_MASK) == 0);
+	lcr4(rcr4() | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns PML4's PCID, or 0 if it has none in the current
+ * generation. */
+static unsigned pml4_pcid(const uint64_t *pml4)
+{
+	uint64_t tag = pml4[PCID_SLOT];
+
+	if (PCID_TAG_GEN(tag) != pcid_gen)
+		return 0;
+	return PCID_TAG_PCID(tag);
+}
+
+/* Starts a new PCID generation, flushing the TLB entries of every
+ * PCID.  Leaves base_pml4 active if INVPCID is unavailable. */
+static void pcid_new_generation(void)
+{
+	pcid_gen++;
+	next_pcid = 1;
+
+	if (invpcid_supported)
+		invpcid(INVPCID_ALL, 0, 0);
+	else
+	{
+		/* Clearing CR4.PCIDE flushes every PCID, but is only
+		 * allowed with PCID 0 in CR3. */
+		lcr3(vtop(base_pml4));
+		lcr4(rcr4() & ~CR4_PCIDE);
+		lcr4(rcr4() | CR4_PCIDE);
+	}
+}
+
+/* Invalidates the TLB entry for VA in PML4 after the entry for VA
+ * in PML4 has been changed. */
+/* PML4의 VA 항목을 변경한 후 해당 TLB 항목을 무효화합니다. */
+static void pml4_invalidate(uint64_t *pml4, uint64_t va)
+{
+	if ((rcr3() & ~CR3_PCID_MASK) == vtop(pml4))
+	{
+		invlpg(va);
+		return;
+	}
+
+	/* Without PCIDs, activating PML4 flushes the TLB anyway. */
+	if (!pcid_enabled)
+		return;
+
+	enum intr_level old_level = intr_disable();
+	unsigned pcid = pml4_pcid(pml4);
+
+	if (pcid != 0)
+	{
+		if (invpcid_supported)
+			invpcid(INVPCID_ADDR, pcid, va);
+		else
+			/* Give up the PCID.  PML4 gets a fresh one, with no
+			 * entries cached, when it is next activated. */
+			pml4[PCID_SLOT] = 0;
+	}
+	intr_set_level(old_level);
+}
+
+/* Returns true if any entry of page table PT is present. */
+static bool pt_has_present(const uint64_t *pt)
+{
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		if (pt[i] & PTE_P)
+			return true;
+	return false;
+}
+
+/* Drops every TLB entry for user addresses in PML4. */
+static void pml4_flush(uint64_t *pml4)
+{
+	if ((rcr3() & ~CR3_PCID_MASK) == vtop(pml4))
+	{
+		/* Without CR3_NOFLUSH, a load flushes the current PCID. */
+		lcr3(rcr3());
+		return;
+	}
+
+	if (!pcid_enabled)
+		return;
+
+	enum intr_level old_level = intr_disable();
+
+	if (pml4_pcid(pml4) != 0)
+		pml4[PCID_SLOT] = 0;
+	intr_set_level(old_level);
+}
+
+/* Batched TLB invalidation.
+ *
+ * Between tlb_gather_begin() and tlb_gather_end(), pml4_clear_page()
+ * run by the thread on the gather's page map does not invalidate the
+ * TLB entry at once, but records the address.  tlb_gather_end() then
+ * invalidates them all together: one by one if there are at most
+ * TLB_GATHER_MAX, or else by flushing the whole page map, which is
+ * cheaper than that many invlpgs.  Page tables taken out with
+ * tlb_gather_free_tables() are only freed after that flush, once the
+ * processor can no longer walk them, and so are the pages unmapped
+ * meanwhile that are passed to tlb_gather_free_page().
+ *
+ * The thread must not touch the pages it unmaps before the batch
+ * ends, since their entries may still be in the TLB.  Other threads'
+ * changes to the page map are invalidated as usual. */
+/* TLB 무효화를 모아서 한 번에 처리합니다. */
+
+/* Starts a batch of invalidations in PML4 for the current thread,
+ * recorded in TLB. */
+void tlb_gather_begin(struct tlb_gather *tlb, uint64_t *pml4)
+{
+	tlb->pml4 = pml4;
+	tlb->va_cnt = 0;
+	tlb->tables = NULL;
+	tlb->pages = NULL;
+#ifdef USERPROG
+	thread_current()->tlb = tlb;
+#endif
+}
+
+#ifdef USERPROG
+/* Records that the entry for VA in TLB's page map changed. */
+static void tlb_gather_page(struct tlb_gather *tlb, uint64_t va)
+{
+	if (tlb->va_cnt < TLB_GATHER_MAX)
+		tlb->va[tlb->va_cnt] = va;
+	if (tlb->va_cnt <= TLB_GATHER_MAX)
+		tlb->va_cnt++;
+}
+#endif
+
+/* Takes the page tables of TLB's page map that cover only addresses
+ * in [START, END) and no longer map any page out of the page map,
+ * to be freed at the end of the batch.  Frames still referenced by
+ * their non-present entries are not freed. */
+void tlb_gather_free_tables(struct tlb_gather *tlb, void *start, void *end)
+{
+	uint64_t va = ((uint64_t)start + LPGMASK) & ~LPGMASK;
+
+	ASSERT(end == NULL || is_user_vaddr((uint8_t *)end - 1));
+
+	while (va + LPGSIZE <= (uint64_t)end)
+	{
+		uint64_t *pde = pml4e_walk_pde(tlb->pml4, va, 0);
+		uint64_t *pt;
+
+		if (pde == NULL)
+		{
+			/* No page directory: skip the gigabyte it would map. */
+			va = (va + (1UL << PDPESHIFT)) & ~((1UL << PDPESHIFT) - 1);
+			continue;
+		}
+		va += LPGSIZE;
+		if (!(*pde & PTE_P) || (*pde & PTE_PS))
+			continue;
+
+		pt = ptov(PTE_ADDR(*pde));
+		if (pt_has_present(pt))
+			continue;
+		*pde = 0;
+		/* Chain it through its first entry, which stays "not
+		 * present" since the link is page aligned. */
+		*(void **)pt = tlb->tables;
+		tlb->tables = pt;
+		tlb->va_cnt = TLB_GATHER_MAX + 1;
+	}
+}
+
+/* Frees KVA, a page that was mapped in PML4 until just now, once
+ * no TLB entry can reach it any more: at the end of the current
+ * thread's batch of invalidations in PML4, if there is one, or else
+ * at once. */
+void tlb_gather_free_page(uint64_t *pml4, void *kva)
+{
+#ifdef USERPROG
+	struct tlb_gather *tlb = thread_current()->tlb;
+
+	if (tlb != NULL && tlb->pml4 == pml4)
+	{
+		*(void **)kva = tlb->pages;
+		tlb->pages = kva;
+		return;
+	}
+#endif
+	palloc_free_page(kva);
+}
+
+/* Frees the pages chained through their first words from *LIST. */
+static void free_chain(void **list)
+{
+	while (*list != NULL)
+	{
+		void *page = *list;
+
+		*list = *(void **)page;
+		palloc_free_page(page);
+	}
+}
+
+/* Ends the batch of invalidations in TLB: makes the TLB forget the
+ * entries changed meanwhile and frees the page tables and pages
+ * taken out. */
+void tlb_gather_end(struct tlb_gather *tlb)
+{
+#ifdef USERPROG
+	thread_current()->tlb = NULL;
+#endif
+	if (tlb->pml4 != NULL)
+	{
+		if (tlb->va_cnt > TLB_GATHER_MAX)
+			pml4_flush(tlb->pml4);
+		else
+			for (size_t i = 0; i < tlb->va_cnt; i++)
+				pml4_invalidate(tlb->pml4, tlb->va[i]);
+	}
+
+	free_chain(&tlb->tables);
+	free_chain(&tlb->pages);
+}
+
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs enabled, the TLB entries of other address
+ * spaces are kept rather than flushed. */
 /* 페이지 디렉터리 PD를 CPU의 페이지 디렉터리 베이스 레지스터에
  * 로드합니다. */
 void pml4_activate(uint64_t *pml4)
 {
-	lcr3(vtop(pml4 ? pml4 : base_pml4));
+	if (!pcid_enabled)
+	{
+		lcr3(vtop(pml4 ? pml4 : base_pml4));
+		return;
+	}
+
+	if (pml4 == NULL || pml4 == base_pml4)
+	{
+		lcr3(vtop(base_pml4) | CR3_NOFLUSH);
+		return;
+	}
+
+	enum intr_level old_level = intr_disable();
+	unsigned pcid = pml4_pcid(pml4);
+
+	if (pcid == 0)
+	{
+		if (next_pcid == PCID_CNT)
+			pcid_new_generation();
+		pcid = next_pcid++;
+		pml4[PCID_SLOT] = PCID_TAG(pcid_gen, pcid);
+	}
+	lcr3(vtop(pml4) | pcid | CR3_NOFLUSH);
+	intr_set_level(old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -262,9 +625,11 @@ void *pml4_get_page(uint64_t *pml4, const void *uaddr)
 
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
-		return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
-	return NULL;
+	if (pte == NULL || !(*pte & PTE_P))
+		return NULL;
+	if (*pte & PTE_PS)
+		return ptov(LPTE_ADDR(*pte)) + lpg_ofs(uaddr);
+	return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
 }
 
 /* Adds a mapping in page map level 4 PML4 from user virtual page
@@ -292,14 +657,137 @@ bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, 1);
 
 	if (pte)
+	{
+		ASSERT(!(*pte & PTE_PS));
 		*pte = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	}
 	return pte != NULL;
 }
 
+/* Returns true if every entry of page table PT is zero. */
+static bool pt_is_empty(const uint64_t *pt)
+{
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		if (pt[i] != 0)
+			return false;
+	return true;
+}
+
+/* Adds a 2 MB mapping in PML4 from user virtual address UPAGE to
+ * the physically contiguous frame at kernel virtual address KPAGE,
+ * using a single page directory entry.  Both UPAGE and KPAGE must
+ * be 2 MB aligned, and KPAGE must span LPG_PAGES pages obtained
+ * together from palloc.  No page in the 2 MB range may already be
+ * mapped; an empty page table left over from earlier small
+ * mappings is released.
+ * Returns true if successful, false if memory allocation failed or
+ * the range is still partly mapped with small pages. */
+/* 사용자 가상 주소 UPAGE에서 KPAGE의 물리적으로 연속된 프레임으로의
+ * 2MB 매핑을 하나의 페이지 디렉터리 항목으로 추가합니다. */
+bool pml4_set_large_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
+{
+	ASSERT(lpg_ofs(upage) == 0);
+	ASSERT(lpg_ofs(kpage) == 0);
+	ASSERT(is_user_vaddr(upage));
+	ASSERT(is_user_vaddr((uint8_t *)upage + LPGSIZE - 1));
+	ASSERT(pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_pde(pml4, (uint64_t)upage, 1);
+
+	if (pde == NULL)
+		return false;
+
+	if (*pde & PTE_P)
+	{
+		ASSERT(!(*pde & PTE_PS));
+
+		uint64_t *pt = ptov(PTE_ADDR(*pde));
+
+		if (!pt_is_empty(pt))
+			return false;
+		*pde = 0;
+		palloc_free_page(pt);
+	}
+
+	*pde = vtop(kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	pml4_invalidate(pml4, (uint64_t)upage);
+	return true;
+}
+
+/* Maps the 2 MB at UPAGE in PML4 to the physically contiguous
+ * frame at KPAGE, as pml4_set_large_page() does, but in place of
+ * the page table that maps the range with small pages, if there is
+ * one, whatever it still holds.  The caller must have unmapped any
+ * small pages there with pml4_clear_page(), which flushes them from
+ * the TLB, and must free their frames itself.
+ * Returns that page table, cleared, or a newly allocated one if
+ * there was none, so that pml4_split_large_page() can later turn the
+ * mapping back into small pages without allocating memory.  Returns
+ * a null pointer, and changes nothing, if memory allocation fails. */
+/* UPAGE의 2MB를 KPAGE로 매핑하되, 작은 페이지들을 매핑하던 페이지
+ * 테이블을 대신하며, 나중에 분할할 때 쓸 그 페이지 테이블을
+ * 반환합니다. */
+uint64_t *pml4_replace_large_page(uint64_t *pml4, void *upage, void *kpage,
+								  bool rw)
+{
+	ASSERT(lpg_ofs(upage) == 0);
+	ASSERT(lpg_ofs(kpage) == 0);
+	ASSERT(is_user_vaddr(upage));
+	ASSERT(is_user_vaddr((uint8_t *)upage + LPGSIZE - 1));
+	ASSERT(pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_pde(pml4, (uint64_t)upage, 1);
+	uint64_t *pt;
+
+	if (pde == NULL)
+		return NULL;
+
+	if (*pde & PTE_P)
+	{
+		ASSERT(!(*pde & PTE_PS));
+		pt = ptov(PTE_ADDR(*pde));
+		memset(pt, 0, PGSIZE);
+	}
+	else if ((pt = palloc_get_page(PAL_ZERO)) == NULL)
+		return NULL;
+
+	*pde = vtop(kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	pml4_invalidate(pml4, (uint64_t)upage);
+	return pt;
+}
+
+/* Splits the large page mapped at UPAGE in PML4 into LPG_PAGES
+ * small pages, mapped by page table PT, which must be a zeroed page
+ * such as pml4_replace_large_page() returns.  Each small page keeps
+ * the permissions and the accessed and dirty bits of the large
+ * one. */
+/* UPAGE의 라지 페이지를 페이지 테이블 PT로 매핑되는 작은 페이지들로
+ * 나눕니다. */
+void pml4_split_large_page(uint64_t *pml4, void *upage, uint64_t *pt)
+{
+	ASSERT(lpg_ofs(upage) == 0);
+	ASSERT(pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_pde(pml4, (uint64_t)upage, 0);
+	uint64_t flags, pa;
+
+	ASSERT(pde != NULL && (*pde & PTE_PS));
+
+	flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	pa = LPTE_ADDR(*pde);
+	for (size_t i = 0; i < LPG_PAGES; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+
+	*pde = vtop(pt) | PTE_U | PTE_W | PTE_P;
+	pml4_invalidate(pml4, (uint64_t)upage);
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If UPAGE lies inside a large page,
+ * the whole 2 MB mapping becomes not present.  Inside a batch of
+ * invalidations, the TLB entry is invalidated when the batch ends. */
 /* 페이지 디렉터리 PD에 사용자 가상 페이지 업페이지를
  * "존재하지 않음"으로 표시합니다. 나중에 페이지에 액세스하면
  * 오류가 발생합니다. 페이지 테이블 항목의 다른 비트는 보존됩니다.
@@ -315,15 +803,25 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 	if (pte != NULL && (*pte & PTE_P) != 0)
 	{
 		*pte &= ~PTE_P;
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)upage);
+#ifdef USERPROG
+		struct tlb_gather *tlb = thread_current()->tlb;
+
+		if (tlb != NULL && tlb->pml4 == pml4)
+		{
+			tlb_gather_page(tlb, (uint64_t)upage);
+			return;
+		}
+#endif
+		pml4_invalidate(pml4, (uint64_t)upage);
 	}
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
- * Returns false if PML4 contains no PTE for VPAGE. */
+ * Returns false if PML4 contains no PTE for VPAGE.
+ * For a VPAGE inside a large page, the dirty and accessed helpers
+ * below read and update the single bit kept for the whole 2 MB. */
 /* PML4의 가상 페이지 VPAGE에 대한 PTE가 깨끗하지 않다면,
  * 즉 PTE가 설치된 이후 페이지가 수정되었다면 true를 반환합니다.
  * PML4에 VPAGE에 대한 PTE가 없는 경우 false를 반환합니다. */
@@ -345,10 +843,27 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t)PTE_D;
+			*pte &= ~(uint64_t)PTE_D;
+
+		pml4_invalidate(pml4, (uint64_t)vpage);
+	}
+}
+
+/* Sets the writable bit in the PTE for virtual page VPAGE in PML4
+ * to WRITABLE.  Does nothing if VPAGE is not mapped. */
+/* PML4의 가상 페이지 VPAGE에 대한 PTE에서 쓰기 가능 비트를
+ * WRITABLE로 설정합니다. */
+void pml4_set_writable(uint64_t *pml4, const void *vpage, bool writable)
+{
+	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	if (pte != NULL && (*pte & PTE_P) != 0)
+	{
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t)PTE_W;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		pml4_invalidate(pml4, (uint64_t)vpage);
 	}
 }
 
@@ -377,9 +892,8 @@ void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t)PTE_A;
+			*pte &= ~(uint64_t)PTE_A;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		pml4_invalidate(pml4, (uint64_t)vpage);
 	}
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -49,6 +50,8 @@ struct pool
 							 /* 가용 페이지의 비트맵. */
 	uint8_t *base;			 /* Base of pool. */
 							 /* pool의 최하단. */
+	size_t page_cnt;		 /* Number of usable pages. */
+							 /* 사용 가능한 페이지 수. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -288,6 +291,7 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem)
 			{
 				page_cnt = ((uint64_t)pool_end - start) / PGSIZE;
 				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				pool->page_cnt += page_cnt;
 				start = (uint64_t)pool_end;
 				goto split;
 			}
@@ -295,6 +299,7 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem)
 			{
 				page_cnt = ((uint64_t)end - start) / PGSIZE;
 				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				pool->page_cnt += page_cnt;
 			}
 		}
 	}
@@ -362,6 +367,40 @@ void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
 	return pages;
 }
 
+/* Obtains LPG_PAGES contiguous free pages whose first page is 2 MB
+   aligned, so that they can be mapped with one large page, and
+   returns the kernel virtual address of the first one.  FLAGS are
+   as for palloc_get_multiple().  The pages may be freed together
+   or one by one. */
+/* 2MB 정렬된 연속 가용 페이지 LPG_PAGES개를 가져와 첫 페이지의
+   커널 가상 주소를 반환합니다. */
+void *palloc_get_large_page(enum palloc_flags flags)
+{
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t bit_cnt = bitmap_size(pool->used_map);
+	size_t page_idx = (LPGSIZE - lpg_ofs(pool->base)) % LPGSIZE / PGSIZE;
+	void *pages = NULL;
+
+	lock_acquire(&pool->lock);
+	for (; page_idx + LPG_PAGES <= bit_cnt; page_idx += LPG_PAGES)
+		if (bitmap_none(pool->used_map, page_idx, LPG_PAGES))
+		{
+			bitmap_set_multiple(pool->used_map, page_idx, LPG_PAGES, true);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release(&pool->lock);
+
+	if (pages != NULL)
+	{
+		if (flags & PAL_ZERO)
+			memset(pages, 0, LPGSIZE);
+	}
+	else if (flags & PAL_ASSERT)
+		PANIC("palloc_get: out of pages");
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -412,6 +451,13 @@ void palloc_free_page(void *page)
 	palloc_free_multiple(page, 1);
 }
 
+/* Returns the number of pages in the kernel pool. */
+/* 커널 풀의 페이지 수를 반환합니다. */
+size_t palloc_kernel_page_cnt(void)
+{
+	return kernel_pool.page_cnt;
+}
+
 /* Initializes pool P as starting at START and ending at END */
 /* pool P를 START에서 시작하여 END에서 끝나는 것으로 초기화합니다. */
 static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end)
@@ -427,6 +473,7 @@ static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t e
 	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf(pgcnt, *bm_base, bm_pages);
 	p->base = (void *)start;
+	p->page_cnt = 0;
 
 	// Mark all to unusable.
 	// 모두 사용 불가능으로 표시합니다.
@@ -341,9 +341,13 @@ tid_t thread_create(const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	t->fdt = palloc_get_multiple(PAL_ZERO & PAL_ASSERT, FDT_PAGES);
-	t->fdt[0] = STDIN_FILENO;
-	t->fdt[1] = STDOUT_FILENO;
+#ifdef USERPROG
+	if (!fdt_init(&t->fdt))
+	{
+		palloc_free_page(t);
+		return TID_ERROR;
+	}
+#endif
 
 	// fork일 때만 자식 프로세스를 고려하면 잠재적 문제가 생길 수 있을 것으로 예상
 	list_push_back(&thread_current()->children, &t->child_elem);
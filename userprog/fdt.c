@@ -0,0 +1,155 @@
+#include "userprog/fdt.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* Initializes FDT with only the console descriptors open.  Returns
+ * false if memory is short. */
+bool fdt_init(struct fd_table *fdt)
+{
+	fdt->size = FDT_INIT_SIZE;
+	fdt->files = calloc(fdt->size, sizeof *fdt->files);
+	fdt->used = bitmap_create(fdt->size);
+	if (fdt->files == NULL || fdt->used == NULL)
+	{
+		free(fdt->files);
+		bitmap_destroy(fdt->used);
+		fdt->files = NULL;
+		fdt->used = NULL;
+		return false;
+	}
+	bitmap_set_multiple(fdt->used, 0, 2, true);
+	return true;
+}
+
+/* Closes the files open in FDT and frees it.  FDT may also be one
+ * that was never initialized, all zeros, or destroyed already. */
+void fdt_destroy(struct fd_table *fdt)
+{
+	size_t fd;
+
+	if (fdt->used == NULL)
+		return;
+
+	for (fd = bitmap_find_next(fdt->used, 2, true); fd != BITMAP_ERROR;
+		 fd = bitmap_find_next(fdt->used, fd + 1, true))
+		file_close(fdt->files[fd]);
+
+	free(fdt->files);
+	bitmap_destroy(fdt->used);
+	fdt->files = NULL;
+	fdt->used = NULL;
+	fdt->size = 0;
+}
+
+/* Makes room in FDT for descriptors up to FD, doubling its size as
+ * many times as it takes.  Returns false if FD is beyond
+ * FDT_MAX_SIZE or memory is short. */
+static bool fdt_grow(struct fd_table *fdt, size_t fd)
+{
+	size_t size = fdt->size;
+	struct file **files;
+	struct bitmap *used;
+	size_t i;
+
+	if (fd < size)
+		return true;
+	if (fd >= FDT_MAX_SIZE)
+		return false;
+	while (size <= fd)
+		size *= 2;
+	if (size > FDT_MAX_SIZE)
+		size = FDT_MAX_SIZE;
+
+	used = bitmap_create(size);
+	if (used == NULL)
+		return false;
+	files = realloc(fdt->files, size * sizeof *files);
+	if (files == NULL)
+	{
+		bitmap_destroy(used);
+		return false;
+	}
+	memset(files + fdt->size, 0, (size - fdt->size) * sizeof *files);
+
+	for (i = bitmap_find_next(fdt->used, 0, true); i != BITMAP_ERROR;
+		 i = bitmap_find_next(fdt->used, i + 1, true))
+		bitmap_mark(used, i);
+	bitmap_destroy(fdt->used);
+
+	fdt->files = files;
+	fdt->used = used;
+	fdt->size = size;
+	return true;
+}
+
+/* Makes DST, a newly initialized table, a copy of SRC, with a
+ * duplicate of each file open in it.  Returns false if memory is
+ * short, with the files copied so far left open in DST. */
+bool fdt_duplicate(struct fd_table *dst, const struct fd_table *src)
+{
+	size_t fd;
+
+	for (fd = bitmap_find_next(src->used, 2, true); fd != BITMAP_ERROR;
+		 fd = bitmap_find_next(src->used, fd + 1, true))
+	{
+		struct file *file = file_duplicate(src->files[fd]);
+
+		if (file == NULL || !fdt_install(dst, fd, file))
+		{
+			file_close(file);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Opens the lowest free descriptor of FDT for FILE and returns it,
+ * or returns -1 if the table cannot grow. */
+int fdt_add(struct fd_table *fdt, struct file *file)
+{
+	size_t fd = bitmap_find_next(fdt->used, 2, false);
+
+	if (fd == BITMAP_ERROR)
+	{
+		fd = fdt->size;
+		if (!fdt_grow(fdt, fd))
+			return -1;
+	}
+	bitmap_mark(fdt->used, fd);
+	fdt->files[fd] = file;
+	return fd;
+}
+
+/* Opens descriptor FD of FDT, which must not be open yet, for
+ * FILE.  Returns false if the table cannot grow that far. */
+bool fdt_install(struct fd_table *fdt, int fd, struct file *file)
+{
+	ASSERT(fd >= 2);
+
+	if (!fdt_grow(fdt, fd))
+		return false;
+	ASSERT(!bitmap_test(fdt->used, fd));
+	bitmap_mark(fdt->used, fd);
+	fdt->files[fd] = file;
+	return true;
+}
+
+/* Returns the file open as FD in FDT, or NULL if there is none. */
+struct file *fdt_get(const struct fd_table *fdt, int fd)
+{
+	if (fd < 2 || (size_t)fd >= fdt->size)
+		return NULL;
+	return fdt->files[fd];
+}
+
+/* Closes descriptor FD of FDT, without closing its file. */
+void fdt_remove(struct fd_table *fdt, int fd)
+{
+	if (fd < 2 || (size_t)fd >= fdt->size)
+		return;
+	bitmap_reset(fdt->used, fd);
+	fdt->files[fd] = NULL;
+}
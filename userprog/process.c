@@ -20,6 +20,7 @@
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #ifdef VM
+#include "threads/malloc.h"
 #include "vm/vm.h"
 #endif
 
@@ -27,6 +28,8 @@ static void process_cleanup(void);
 static bool load(const char *file_name, struct intr_frame *if_);
 static void initd(void *f_name);
 static void __do_fork(void *);
+static void __do_spawn(void *);
+static bool process_load(char *file_name, struct intr_frame *if_);
 
 // main thread (tid == 1)
 static struct thread *main_thread;
@@ -221,6 +224,25 @@ static bool duplicate_pte(uint64_t *pte, void *va, void *aux)
 		return true;
 	}
 
+	/* 라지 페이지는 4KB 페이지 512개로 나누어 복제합니다.
+	 * (자식 쪽에는 정렬된 2MB 프레임이 있다는 보장이 없습니다.) */
+	if (is_large_pte(pte))
+	{
+		uint64_t sub = *pte & ~(uint64_t)PTE_PS;
+
+		for (size_t i = 0; i < LPG_PAGES; i++)
+		{
+			uint64_t sub_pte = (LPTE_ADDR(sub) + i * PGSIZE) | (sub & PTE_FLAGS);
+
+			if (!duplicate_pte(&sub_pte, (uint8_t *)va + i * PGSIZE, aux))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	/* 2. 상위 페이지 맵 레벨 4에서 VA를 해결합니다. */
 	void *parent_page = pml4_get_page(parent->pml4, va);
 
@@ -417,21 +439,11 @@ static void __do_fork(void *aux)
 	 * 이 함수가 부모의 자원을 성공적으로 복제할 때까지
 	 * 부모는 fork()에서 반환되지 않아야 한다.
 	 */
-	int idx = 2;
-
 	// lock_acquire(&filesys_lock);
 
-	current->fdt[0] = parent->fdt[0];
-	current->fdt[1] = parent->fdt[1];
-
-	while (idx < FDT_SIZE)
+	if (!fdt_duplicate(&current->fdt, &parent->fdt))
 	{
-		if (parent->fdt[idx] != NULL)
-		{
-			current->fdt[idx] = file_duplicate(parent->fdt[idx]);
-		}
-
-		idx++;
+		goto error;
 	}
 
 	// lock_release(&filesys_lock);
@@ -454,6 +466,127 @@ error:
 	exit(-1);
 }
 
+/* What process_spawn() hands to the new process. */
+struct spawn_args
+{
+	struct thread *parent;
+	char *cmd_line;			/* Kernel copy, freed by the child. */
+	const int *fds;			/* Descriptors to pass on, or NULL. */
+	size_t fd_cnt;			/* Number of elements in FDS. */
+	bool success;			/* Did the program load? */
+	struct semaphore done;	/* Upped once the child is done with
+							   this and with its parent. */
+};
+
+/* Starts a new child process running the command line CMD_LINE,
+ * without copying anything of the current process's address space,
+ * and returns its thread id, or TID_ERROR if it cannot be created
+ * or its program cannot be loaded.  Like vfork() followed by exec(),
+ * the caller waits until the program is loaded.
+ *
+ * If FDS is null, the child inherits all open file descriptors.
+ * Otherwise, for 2 <= I < FD_CNT, its descriptor I refers to the
+ * file open as the caller's FDS[I], or is closed if FDS[I] is not
+ * an open file; descriptors 0 and 1 are always the console. */
+tid_t process_spawn(const char *cmd_line, const int *fds, size_t fd_cnt)
+{
+	struct spawn_args args;
+	char name[16];
+	tid_t tid;
+
+	args.parent = thread_current();
+	args.cmd_line = palloc_get_page(0);
+	if (args.cmd_line == NULL)
+	{
+		return TID_ERROR;
+	}
+	strlcpy(args.cmd_line, cmd_line, PGSIZE);
+	args.fds = fds;
+	args.fd_cnt = fd_cnt;
+	args.success = false;
+	sema_init(&args.done, 0);
+
+	/* The thread is named after the program. */
+	strlcpy(name, cmd_line, sizeof name);
+	name[strcspn(name, " ")] = '\0';
+
+	tid = thread_create(name, PRI_DEFAULT, __do_spawn, &args);
+	if (tid == TID_ERROR)
+	{
+		palloc_free_page(args.cmd_line);
+		return TID_ERROR;
+	}
+
+	sema_down(&args.done);
+	return args.success ? tid : TID_ERROR;
+}
+
+/* Gives CURRENT, a new process, the file descriptors FDS describes
+ * among those of PARENT, which is waiting; see process_spawn().
+ * Only the open descriptors are visited.  Returns false if memory
+ * is short, with the descriptors given so far left open. */
+static bool spawn_fds(struct thread *current, struct thread *parent,
+					  const int *fds, size_t fd_cnt)
+{
+	if (fds == NULL)
+	{
+		return fdt_duplicate(&current->fdt, &parent->fdt);
+	}
+
+	for (size_t i = 2; i < fd_cnt; i++)
+	{
+		struct file *file = fdt_get(&parent->fdt, fds[i]);
+
+		if (file == NULL)
+		{
+			continue;
+		}
+		if ((file = file_duplicate(file)) == NULL)
+		{
+			return false;
+		}
+		if (!fdt_install(&current->fdt, i, file))
+		{
+			file_close(file);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* A thread function that starts a process for process_spawn(). */
+static void __do_spawn(void *aux)
+{
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current();
+	struct intr_frame if_;
+	bool success;
+
+#ifdef VM
+	supplemental_page_table_init(&current->spt);
+#endif
+	process_init();
+
+	success = spawn_fds(current, args->parent, args->fds, args->fd_cnt) &&
+			  process_load(args->cmd_line, &if_);
+	palloc_free_page(args->cmd_line);
+
+	/* A child that never ran is not the parent's to wait for. */
+	if (!success)
+	{
+		list_remove(&current->child_elem);
+	}
+	args->success = success;
+	sema_up(&args->done);
+
+	if (success)
+	{
+		do_iret(&if_);
+	}
+	current->exit_status = -1;
+	thread_exit();
+}
+
 void set_userstack(char **argv, int argc, struct intr_frame *if_)
 {
 	char *addrs[64];
@@ -490,21 +623,15 @@ void set_userstack(char **argv, int argc, struct intr_frame *if_)
 	memset(if_->rsp, 0, sizeof(void *));
 }
 
-/* process_exec - 현재 실행 컨텍스트를 f_name으로 전환한다.
- * 실패 시 -1을 반환한다.
- */
-int process_exec(void *f_name)
+/* Replaces the current address space with the program named by
+ * the command line FILE_NAME, which is split up in place, and sets
+ * up *IF_ to start it with its arguments.  Returns true if
+ * successful. */
+static bool process_load(char *file_name, struct intr_frame *if_)
 {
-	char *file_name = f_name;
-	bool success;
-
-	/* 스레드 구조체에서는 intr_frame을 사용할 수 없다.
-	 * 현재 스레드가 재스케줄 될 때 실행 정보를 멤버에 저장하기 때문이다.
-	 */
-	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+	if_->ds = if_->es = if_->ss = SEL_UDSEG;
+	if_->cs = SEL_UCSEG;
+	if_->eflags = FLAG_IF | FLAG_MBS;
 
 	/* 먼저 현재 컨텍스트를 죽인다. */
 	process_cleanup();
@@ -517,13 +644,31 @@ int process_exec(void *f_name)
 		argv[argc++] = token;
 
 	/* 그리고 바이너리를 불러온다. */
-	success = load(file_name, &_if);
+	if (!load(file_name, if_))
+		return false;
 
 	/* Project 2: Argument Passing*/
-	set_userstack(argv, argc, &_if);
-	_if.R.rdi = argc;
-	_if.R.rsi = _if.rsp + 8;
-	// hex_dump(_if.rsp, _if.rsp, USER_STACK - (uint64_t)_if.rsp, true);
+	set_userstack(argv, argc, if_);
+	if_->R.rdi = argc;
+	if_->R.rsi = if_->rsp + 8;
+	// hex_dump(if_->rsp, if_->rsp, USER_STACK - (uint64_t)if_->rsp, true);
+	return true;
+}
+
+/* process_exec - 현재 실행 컨텍스트를 f_name으로 전환한다.
+ * 실패 시 -1을 반환한다.
+ */
+int process_exec(void *f_name)
+{
+	char *file_name = f_name;
+	bool success;
+
+	/* 스레드 구조체에서는 intr_frame을 사용할 수 없다.
+	 * 현재 스레드가 재스케줄 될 때 실행 정보를 멤버에 저장하기 때문이다.
+	 */
+	struct intr_frame _if;
+
+	success = process_load(file_name, &_if);
 
 	/* 로드에 실패하면 종료한다. */
 	palloc_free_page(file_name);
@@ -620,8 +765,7 @@ void process_exit(void)
 	file_close(curr->loading_file);
 	curr->loading_file = NULL;
 
-	palloc_free_multiple(curr->fdt, FDT_PAGES);
-	curr->fdt = NULL;
+	fdt_destroy(&curr->fdt);
 
 	/* 프로세스의 리소스를 정리하기 위해 process_cleanup() 함수 호출 */
 	process_cleanup();
@@ -675,7 +819,14 @@ static void process_cleanup(void)
 	struct thread *curr = thread_current();
 
 #ifdef VM
+	struct tlb_gather tlb;
+
+	/* Unmap everything with one TLB flush, and free the page tables
+	 * left empty in one batch. */
+	tlb_gather_begin(&tlb, curr->pml4);
 	supplemental_page_table_kill(&curr->spt);
+	tlb_gather_free_tables(&tlb, NULL, (void *)ROUND_UP(USER_STACK, LPGSIZE));
+	tlb_gather_end(&tlb);
 #endif
 
 	/* Destroy the current process's page directory and switch back
@@ -1179,12 +1330,23 @@ static bool install_page(void *upage, void *kpage, bool writable)
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
+/* Reads PAGE's part of the segment described by AUX, a struct
+ * file_segment, into its frame and zeroes the rest.  Called on the
+ * first fault on the page, which consumes AUX. */
 static bool
 lazy_load_segment(struct page *page, void *aux)
 {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+	struct file_segment *seg = aux;
+	uint8_t *kva = page->frame->kva;
+	bool success;
+
+	success = file_read_at(seg->file, kva, seg->read_bytes, seg->ofs) == (off_t)seg->read_bytes;
+	if (success)
+		memset(kva + seg->read_bytes, 0, PGSIZE - seg->read_bytes);
+
+	file_close(seg->file);
+	free(seg);
+	return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -1217,15 +1379,50 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-											writable, lazy_load_segment, aux))
-			return false;
+		/* Pages with nothing to read need no loader; they are
+		 * zero-filled on first use. */
+		if (page_read_bytes == 0)
+		{
+			if (!vm_alloc_page(VM_ANON, upage, writable))
+				return false;
+		}
+		else
+		{
+			/* Each page gets its own handle on FILE, since the
+			 * process may close its handle or fork before the page
+			 * is loaded. */
+			struct file_segment *seg = malloc(sizeof *seg);
+			bool ok;
+
+			if (seg == NULL)
+				return false;
+			seg->file = file_reopen(file);
+			seg->ofs = ofs;
+			seg->read_bytes = page_read_bytes;
+			seg->map = NULL;
+
+			/* Read-only pages are shared with other processes
+			 * running the same program, through the text cache. */
+			if (writable)
+				ok = seg->file != NULL && vm_alloc_page_with_initializer(VM_ANON, upage, true, lazy_load_segment, seg);
+			else
+				ok = seg->file != NULL && vm_alloc_page_with_initializer(VM_FILE | VM_TEXT, upage, false, NULL, seg);
+			if (!ok)
+			{
+				file_close(seg->file);
+				free(seg);
+				return false;
+			}
+
+			/* If another process has the page loaded, map it now. */
+			if (!writable)
+				vm_claim_cached_page(upage);
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
+		ofs += page_read_bytes;
 		upage += PGSIZE;
 	}
 	return true;
@@ -1238,10 +1435,13 @@ setup_stack(struct intr_frame *if_)
 	bool success = false;
 	void *stack_bottom = (void *)(((uint8_t *)USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
+	/* The first stack page is claimed now, since argument passing
+	 * writes to it right away. */
+	if (vm_alloc_page(VM_ANON, stack_bottom, true) && vm_claim_page(stack_bottom))
+	{
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 
 	return success;
 }
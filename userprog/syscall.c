@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -10,11 +11,16 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
@@ -31,6 +37,7 @@ void halt();
 void exit(int status);
 int fork(const char *thread_name, struct intr_frame *f);
 bool exec(const char *cmd_line);
+int spawn(const char *cmd_line, const int *fds, size_t fd_cnt);
 int wait(int pid);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
@@ -38,9 +45,19 @@ int open(const char *file);
 int filesize(int fd);
 int read(int fd, void *buffer, unsigned size);
 int write(int fd, const void *buffer, unsigned size);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int pread(int fd, void *buffer, unsigned size, off_t offset);
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset);
+int copy_file_range(int fd_in, int fd_out, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
+#ifdef VM
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap(void *addr);
+int msync(void *addr, size_t length, int flags);
+#endif
 
 /* System call.
  *
@@ -96,6 +113,9 @@ void syscall_handler(struct intr_frame *f)
 	// printf("[syscall] syscall_handler - system call!\n");
 
 	thread_current()->tf = *f;
+#ifdef VM
+	thread_current()->user_rsp = (void *)f->rsp;
+#endif
 
 	switch (f->R.rax) // 시스템 콜 번호
 	{
@@ -114,6 +134,9 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_WAIT:
 		f->R.rax = wait(f->R.rdi);
 		break;
+	case SYS_SPAWN:
+		f->R.rax = spawn((const char *)f->R.rdi, (const int *)f->R.rsi, f->R.rdx);
+		break;
 	case SYS_CREATE:
 		f->R.rax = create(f->R.rdi, f->R.rsi);
 		break;
@@ -132,6 +155,21 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_WRITE:
 		f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
 		break;
+	case SYS_READV:
+		f->R.rax = readv(f->R.rdi, (const struct iovec *)f->R.rsi, f->R.rdx);
+		break;
+	case SYS_WRITEV:
+		f->R.rax = writev(f->R.rdi, (const struct iovec *)f->R.rsi, f->R.rdx);
+		break;
+	case SYS_PREAD:
+		f->R.rax = pread(f->R.rdi, (void *)f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_PWRITE:
+		f->R.rax = pwrite(f->R.rdi, (const void *)f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_COPY_FILE_RANGE:
+		f->R.rax = copy_file_range(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
 	case SYS_SEEK:
 		seek(f->R.rdi, f->R.rsi);
 		break;
@@ -141,6 +179,17 @@ void syscall_handler(struct intr_frame *f)
 	case SYS_CLOSE:
 		close(f->R.rdi);
 		break;
+#ifdef VM
+	case SYS_MMAP:
+		f->R.rax = (uint64_t)mmap((void *)f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+		break;
+	case SYS_MUNMAP:
+		munmap((void *)f->R.rdi);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+#endif
 	default:
 		thread_exit();
 		break;
@@ -161,21 +210,38 @@ void syscall_handler(struct intr_frame *f)
 // 	return is_valid_user_ptr(uaddr) && is_valid_user_ptr(uaddr + len - 1);
 // }
 
-/* check_address - 주소가 유효한지 확인한다.
+/* user_address_ok - 현재 프로세스가 사용자 주소 addr에 접근할 수 있으면
+ * 참을 반환한다. 프로세스를 종료하지 않는다.
  */
-void check_address(uintptr_t addr)
+static bool user_address_ok(const void *addr)
 {
-	if (addr == NULL)
+	if (addr == NULL || !is_user_vaddr(addr))
 	{
-		exit(-1);
+		return false;
 	}
 
-	if (pml4_get_page(thread_current()->pml4, (void *)addr) == NULL)
+	if (pml4_get_page(thread_current()->pml4, addr) != NULL)
 	{
-		exit(-1);
+		return true;
 	}
 
-	if (!is_user_vaddr(addr))
+#ifdef VM
+	/* Pages that are not loaded yet, and stack pages not yet
+	 * grown into, are faulted in when the kernel touches them. */
+	struct thread *t = thread_current();
+
+	return spt_find_page(&t->spt, (void *)addr) != NULL ||
+		   vm_stack_access(addr, t->user_rsp);
+#else
+	return false;
+#endif
+}
+
+/* check_address - 주소가 유효한지 확인한다.
+ */
+void check_address(uintptr_t addr)
+{
+	if (!user_address_ok((void *)addr))
 	{
 		exit(-1);
 	}
@@ -237,6 +303,48 @@ bool exec(const char *cmd_line)
 	}
 }
 
+/* spawn - cmd_line을 실행하는 자식 프로세스를 만들고 pid를 반환한다.
+ * fork와 달리 부모의 주소 공간을 복제하지 않는다. 부모는 자식이 프로그램을
+ * 불러올 때까지 기다리며, 불러오지 못하면 -1을 반환한다.
+ * fds가 NULL이면 자식은 열린 fd를 모두 물려받고, 그렇지 않으면 자식의
+ * fd i(2 <= i < fd_cnt)는 부모의 fd fds[i]를 가리킨다.
+ */
+int spawn(const char *cmd_line, const int *fds, size_t fd_cnt)
+{
+	check_address((uintptr_t)cmd_line);
+
+	int *kfds = NULL;
+
+	if (fds != NULL)
+	{
+		if (fd_cnt > FDT_MAX_SIZE)
+		{
+			return -1;
+		}
+
+		if (fd_cnt > 0)
+		{
+			check_address((uintptr_t)fds);
+			check_address((uintptr_t)(fds + fd_cnt) - 1);
+		}
+
+		/* The child cannot read the parent's memory. */
+		kfds = malloc(fd_cnt * sizeof *kfds);
+
+		if (kfds == NULL && fd_cnt > 0)
+		{
+			return -1;
+		}
+
+		memcpy(kfds, fds, fd_cnt * sizeof *kfds);
+	}
+
+	tid_t tid = process_spawn(cmd_line, kfds, fd_cnt);
+
+	free(kfds);
+	return tid;
+}
+
 /* wait - 자식 프로세스 pid를 기다렸다가 자식의 종료 상태를 확인한다.
  * 해당 자식 프로세스가 아직 실행 중이면 종료될 때까지 기다린다.
  * 그리고 자식 프로세스가 종료되면, 종료 시에 전달된 상태를 반환한다.
@@ -344,6 +452,111 @@ int filesize(int fd)
 	return file_length(_file);
 }
 
+/* 시스템 콜이 한 번에 고정(pin)하는 사용자 버퍼의 최대 바이트 수.
+ * 큰 버퍼도 이만큼씩 나누어 고정, 전송, 해제하므로 사용자 풀보다 많은
+ * 프레임을 한꺼번에 붙잡지 않는다. */
+#define PIN_CHUNK (16 * PGSIZE)
+
+/* pin_chunk - 사용자 버퍼 buffer의 size 바이트 중 한 번에 다룰 앞부분의
+ * 길이를 돌려준다. VM에서는 그 부분을 고정하며, unpin_chunk()로 해제해야
+ * 한다. 버퍼가 매핑되어 있지 않거나 kernel_writes인데 쓸 수 없으면
+ * 프로세스를 종료한다.
+ */
+static size_t pin_chunk(const void *buffer, size_t size,
+						bool kernel_writes UNUSED)
+{
+	size_t chunk = PIN_CHUNK - pg_ofs(buffer);
+
+	if (chunk > size)
+	{
+		chunk = size;
+	}
+
+#ifdef VM
+	if (!vm_pin_buffer(buffer, chunk, kernel_writes))
+	{
+		exit(-1);
+	}
+#endif
+	return chunk;
+}
+
+/* unpin_chunk - pin_chunk()가 고정한 chunk 바이트를 해제한다. */
+static void unpin_chunk(const void *buffer UNUSED, size_t chunk UNUSED)
+{
+#ifdef VM
+	vm_unpin_buffer(buffer, chunk);
+#endif
+}
+
+/* file_xfer - 파일의 pos 위치와 사용자 buffer 사이에서 size 바이트를
+ * PIN_CHUNK씩 나누어 옮긴다. kernel_writes가 참이면 파일에서 buffer로
+ * 읽고, 거짓이면 buffer를 파일에 쓴다. 옮긴 바이트 수를 반환하며,
+ * 파일 위치는 바꾸지 않는다.
+ */
+static int file_xfer(struct file *file, void *buffer, size_t size, off_t pos,
+					 bool kernel_writes)
+{
+	uint8_t *buf = buffer;
+	int total = 0;
+
+#ifdef VM
+	/* Pages unmapped dirty may not be written back yet. */
+	file_writeback_sync(file_get_inode(file));
+#endif
+
+	while (size > 0)
+	{
+		size_t chunk = pin_chunk(buf, size, kernel_writes);
+		off_t n = kernel_writes ? file_read_at(file, buf, chunk, pos)
+								: file_write_at(file, buf, chunk, pos);
+
+		unpin_chunk(buf, chunk);
+		total += n;
+		pos += n;
+		buf += n;
+		size -= n;
+		if ((size_t)n < chunk)
+		{
+			break;
+		}
+	}
+	return total;
+}
+
+/* console_xfer - 콘솔과 사용자 buffer 사이에서 size 바이트를 PIN_CHUNK씩
+ * 나누어 옮긴다. kernel_writes가 참이면 키보드에서 buffer로 읽고, 거짓이면
+ * buffer를 콘솔에 쓴다. 작은 버퍼는 putbuf() 한 번으로 쓴다. 옮긴 바이트
+ * 수를 반환한다.
+ */
+static int console_xfer(void *buffer, size_t size, bool kernel_writes)
+{
+	char *buf = buffer;
+	int total = 0;
+
+	while (size > 0)
+	{
+		size_t chunk = pin_chunk(buf, size, kernel_writes);
+
+		if (kernel_writes)
+		{
+			for (size_t i = 0; i < chunk; i++)
+			{
+				buf[i] = input_getc();
+			}
+		}
+		else
+		{
+			putbuf(buf, chunk);
+		}
+		unpin_chunk(buf, chunk);
+		total += chunk;
+		buf += chunk;
+		size -= chunk;
+	}
+	return total;
+}
+
 /* read - fd로 열린 파일에서 buffer로 size 바이트를 읽는다.
  * 실제로 읽은 바이트 수(파일 끝에서 0) 또는
  * 파일을 읽을 수 없는 경우(파일 끝이 아닌 다른 조건으로 인해) -1을 반환한다.
@@ -360,19 +573,20 @@ int read(int fd, void *buffer, unsigned size)
 		return -1;
 	}
 
-	int byte = 0;
-	char *_buffer = buffer;
+	int byte;
 
 	if (fd == 0)
 	{
-		while (byte < size)
-		{
-			_buffer[byte++] = input_getc();
-		}
-		return byte;
+		byte = console_xfer(buffer, size, true);
 	}
+	else
+	{
+		off_t pos = file_tell(_file);
 
-	return file_read(_file, buffer, size);
+		byte = file_xfer(_file, buffer, size, pos, true);
+		file_seek(_file, pos + byte);
+	}
+	return byte;
 }
 
 /* write - fd로 열린 파일에 buffer에서 size 바이트를 쓴다.
@@ -391,20 +605,267 @@ int write(int fd, const void *buffer, unsigned size)
 		return -1;
 	}
 
+	struct file *_file = NULL;
+	int byte;
+
+	if (fd != 1)
+	{
+		_file = get_file_from_fd(fd);
+
+		if (_file == NULL)
+		{
+			return -1;
+		}
+	}
+
 	if (fd == 1)
 	{
-		putbuf(buffer, size);
-		return size;
+		byte = console_xfer((void *)buffer, size, false);
+	}
+	else
+	{
+		off_t pos = file_tell(_file);
+
+		byte = file_xfer(_file, (void *)buffer, size, pos, false);
+		file_seek(_file, pos + byte);
+	}
+	return byte;
+}
+
+/* iov_get - 사용자 주소 uiov의 iovec 배열 iovcnt개를 커널 메모리로 복사한
+ * 뒤 그 복사본을 검사한다. 검사한 뒤에 사용자가 배열을 바꾸어도 커널은
+ * 검사한 항목만 쓴다. 버퍼 주소가 잘못되었으면 프로세스를 종료하고,
+ * iovcnt가 범위를 벗어나거나 길이의 합이 int를 넘으면 NULL을 반환한다.
+ * 돌려준 배열은 free()로 해제한다.
+ */
+static struct iovec *iov_get(const struct iovec *uiov, int iovcnt)
+{
+	size_t total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+	{
+		return NULL;
+	}
+
+	/* 배열 전체가 사용자 영역에 있어야 한다. */
+	check_address((uintptr_t)uiov);
+	check_address((uintptr_t)(uiov + iovcnt) - 1);
+
+	struct iovec *iov = malloc(iovcnt * sizeof *iov);
+
+	if (iov == NULL)
+	{
+		return NULL;
 	}
 
+	memcpy(iov, uiov, iovcnt * sizeof *iov);
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		if (iov[i].iov_len == 0)
+		{
+			continue;
+		}
+
+		total += iov[i].iov_len;
+		if (total > INT_MAX)
+		{
+			free(iov);
+			return NULL;
+		}
+
+		if (!user_address_ok(iov[i].iov_base) ||
+			!user_address_ok((uint8_t *)iov[i].iov_base + iov[i].iov_len - 1))
+		{
+			free(iov);
+			exit(-1);
+		}
+	}
+
+	return iov;
+}
+
+/* readv - fd로 열린 파일에서 iov가 가리키는 iovcnt개의 버퍼로 차례로 읽는다.
+ * 읽은 바이트 수를 반환하며, 파일 위치는 그만큼 나아간다.
+ * 실패하면 -1을 반환한다.
+ */
+int readv(int fd, const struct iovec *uiov, int iovcnt)
+{
 	struct file *_file = get_file_from_fd(fd);
 
-	if (_file == NULL)
+	if (fd != 0 && _file == NULL)
 	{
 		return -1;
 	}
 
-	return file_write(_file, buffer, size);
+	if (iovcnt == 0)
+	{
+		return 0;
+	}
+
+	struct iovec *iov = iov_get(uiov, iovcnt);
+
+	if (iov == NULL)
+	{
+		return -1;
+	}
+
+	int total = 0;
+	off_t pos = fd == 0 ? 0 : file_tell(_file);
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		int n = fd == 0
+					? console_xfer(iov[i].iov_base, iov[i].iov_len, true)
+					: file_xfer(_file, iov[i].iov_base, iov[i].iov_len, pos,
+								true);
+
+		pos += n;
+		total += n;
+		if ((size_t)n < iov[i].iov_len)
+		{
+			break;
+		}
+	}
+
+	if (fd != 0)
+	{
+		file_seek(_file, pos);
+	}
+	free(iov);
+	return total;
+}
+
+/* writev - iov가 가리키는 iovcnt개의 버퍼를 차례로 fd로 열린 파일에 쓴다.
+ * 쓴 바이트 수를 반환하며, 파일 위치는 그만큼 나아간다.
+ * 실패하면 -1을 반환한다.
+ */
+int writev(int fd, const struct iovec *uiov, int iovcnt)
+{
+	struct file *_file = get_file_from_fd(fd);
+
+	if (fd != 1 && _file == NULL)
+	{
+		return -1;
+	}
+
+	if (iovcnt == 0)
+	{
+		return 0;
+	}
+
+	struct iovec *iov = iov_get(uiov, iovcnt);
+
+	if (iov == NULL)
+	{
+		return -1;
+	}
+
+	int total = 0;
+	off_t pos = fd == 1 ? 0 : file_tell(_file);
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		int n = fd == 1
+					? console_xfer(iov[i].iov_base, iov[i].iov_len, false)
+					: file_xfer(_file, iov[i].iov_base, iov[i].iov_len, pos,
+								false);
+
+		pos += n;
+		total += n;
+		if ((size_t)n < iov[i].iov_len)
+		{
+			break;
+		}
+	}
+
+	if (fd != 1)
+	{
+		file_seek(_file, pos);
+	}
+	free(iov);
+	return total;
+}
+
+/* pread - fd로 열린 파일의 offset 위치부터 buffer로 size 바이트를 읽는다.
+ * 파일 위치는 바뀌지 않는다. 읽은 바이트 수를, 실패하면 -1을 반환한다.
+ */
+int pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	check_address((uintptr_t)buffer);
+
+	struct file *_file = get_file_from_fd(fd);
+
+	if (_file == NULL || offset < 0)
+	{
+		return -1;
+	}
+
+	return file_xfer(_file, buffer, size, offset, true);
+}
+
+/* pwrite - buffer의 size 바이트를 fd로 열린 파일의 offset 위치에 쓴다.
+ * 파일 위치는 바뀌지 않는다. 쓴 바이트 수를, 실패하면 -1을 반환한다.
+ */
+int pwrite(int fd, const void *buffer, unsigned size, off_t offset)
+{
+	check_address((uintptr_t)buffer);
+
+	struct file *_file = get_file_from_fd(fd);
+
+	if (_file == NULL || offset < 0)
+	{
+		return -1;
+	}
+
+	return file_xfer(_file, (void *)buffer, size, offset, false);
+}
+
+/* copy_file_range - fd_in으로 열린 파일의 현재 위치부터 size 바이트를
+ * fd_out으로 열린 파일의 현재 위치로 커널 안에서 복사하고, 두 파일의 위치를
+ * 복사한 바이트 수만큼 전진시킨다. 데이터가 사용자 버퍼를 거치지 않으므로
+ * read와 write를 반복하는 것보다 시스템 콜과 복사가 적다.
+ * 복사한 바이트 수를, 실패하거나 같은 파일에서 두 범위가 겹치면 -1을 반환한다.
+ */
+int copy_file_range(int fd_in, int fd_out, unsigned size)
+{
+	struct file *in = get_file_from_fd(fd_in);
+	struct file *out = get_file_from_fd(fd_out);
+
+	if (in == NULL || out == NULL)
+	{
+		return -1;
+	}
+
+	if (size > INT_MAX)
+	{
+		size = INT_MAX;
+	}
+
+	struct inode *in_inode = file_get_inode(in);
+	struct inode *out_inode = file_get_inode(out);
+
+	if (in_inode == out_inode)
+	{
+		/* 64비트로 비교해야 위치와 size를 더해도 넘치지 않는다. */
+		int64_t in_pos = file_tell(in);
+		int64_t out_pos = file_tell(out);
+
+		if (in_pos < out_pos + size && out_pos < in_pos + size)
+		{
+			return -1;
+		}
+	}
+
+#ifdef VM
+	file_writeback_sync(in_inode);
+	if (out_inode != in_inode)
+	{
+		file_writeback_sync(out_inode);
+	}
+#endif
+
+	return file_copy(out, in, size);
 }
 
 /* 열린 파일 fd에서 읽거나 쓸 다음 바이트를 파일 시작부터 바이트 단위로 표시되는
@@ -455,50 +916,72 @@ void close(int fd)
 	remove_file_from_fdt(fd);
 }
 
-// file을 fdt에 추가하고 fd를 반환한다.
-int add_file_to_fdt(struct file *file)
+#ifdef VM
+/* mmap - fd로 열린 파일의 offset부터 length 바이트를 addr에 매핑한다.
+ * 매핑의 시작 주소를, 실패하면 MAP_FAILED(NULL)를 반환한다. */
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 {
-	struct thread *t = thread_current();
-	int fd = 2;
+	struct file *_file = get_file_from_fd(fd);
 
-	while (t->fdt[fd] != NULL && fd < FDT_SIZE)
+	if (_file == NULL || addr == NULL || pg_ofs(addr) != 0 ||
+		offset < 0 || pg_ofs(offset) != 0 || length == 0)
 	{
-		fd++;
+		return NULL;
 	}
 
-	if (fd >= FDT_SIZE)
+	/* The whole range must be user memory, without wrapping. */
+	if ((uint64_t)addr + length < (uint64_t)addr ||
+		!is_user_vaddr(addr) || !is_user_vaddr((uint8_t *)addr + length - 1))
 	{
-		return -1;
+		return NULL;
 	}
 
-	t->fdt[fd] = file;
+	if (file_length(_file) == 0)
+	{
+		return NULL;
+	}
 
-	return fd;
+	return do_mmap(addr, length, writable, _file, offset);
 }
 
-// fd에 해당하는 file을 fdt에서 제거한다.
-void remove_file_from_fdt(int fd)
+/* munmap - addr에서 시작하는 매핑을 해제한다.
+ * 변경된 페이지는 파일에 다시 쓰인다. */
+void munmap(void *addr)
 {
-	struct thread *t = thread_current();
-
-	t->fdt[fd] = NULL;
+	do_munmap(addr);
 }
 
-// fd에 해당하는 file을 반환한다.
-struct file *get_file_from_fd(int fd)
+/* msync - [addr, addr + length)의 매핑된 페이지를 파일에 다시 쓴다.
+ * MS_SYNC이면 반환하기 전에, MS_ASYNC이면 writeback 스레드가 곧 쓴다.
+ * 성공하면 0을, 범위가 매핑되어 있지 않으면 -1을 반환한다. */
+int msync(void *addr, size_t length, int flags)
 {
-	if (fd < 2 || fd >= FDT_SIZE)
+	if (addr == NULL || pg_ofs(addr) != 0 ||
+		(uint64_t)addr + length < (uint64_t)addr ||
+		!is_user_vaddr((uint8_t *)addr + length - 1) ||
+		(flags & ~(MS_ASYNC | MS_SYNC)) != 0)
 	{
-		return NULL;
+		return -1;
 	}
 
-	struct thread *t = thread_current();
-	struct file *_file = t->fdt[fd];
+	return do_msync(addr, length, flags) ? 0 : -1;
+}
+#endif
 
-	if (_file == NULL)
-	{
-		return NULL;
-	}
+// file을 fdt에 추가하고 fd를 반환한다.
+int add_file_to_fdt(struct file *file)
+{
+	return fdt_add(&thread_current()->fdt, file);
+}
 
-	return _file;
-}
\ No newline at end of file
+// fd에 해당하는 file을 fdt에서 제거한다.
+void remove_file_from_fdt(int fd)
+{
+	fdt_remove(&thread_current()->fdt, fd);
+}
+
+// fd에 해당하는 file을 반환한다.
+struct file *get_file_from_fd(int fd)
+{
+	return fdt_get(&thread_current()->fdt, fd);
+}
@@ -1,7 +1,15 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,36 +25,431 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Swap space.
+ *
+ * The swap disk is divided into slots of SLOT_SECTORS consecutive
+ * sectors, each holding one page.  Slots are handed out next-fit
+ * from a rotating cursor, so the pages of successive evictions land
+ * next to each other on disk, and the free space behind the cursor
+ * has time to coalesce into runs long enough for whole clusters. */
+#define SLOT_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct bitmap *swap_slots;  /* Slots in use. */
+static size_t swap_cursor;         /* Where the next slot search starts. */
+static struct lock swap_lock;      /* Protects swap_slots and swap_cursor,
+                                      the shared slots, and the swap
+                                      cache. */
+
+/* A frame shared by several pages, copy-on-write or merged, is
+ * written to a single slot that all of them then refer to.  Such a
+ * slot is entered in SHARED_SLOTS with the number of pages referring
+ * to it, and it is freed when the last of them lets it go. */
+struct slot_share {
+	size_t ref_cnt;        /* Pages referring to the slot. */
+};
+
+static struct phash shared_slots;  /* Slot to struct slot_share. */
+static size_t shared_evict_cnt;    /* Shared frames swapped out. */
+
+/* Swap readahead.
+ *
+ * Pages evicted together are written to consecutive slots, and pages
+ * next to each other in memory tend to be used together, so when a
+ * page is read back from slot S, the pages after it whose contents
+ * are in slots S + 1, S + 2, ... are read too, with the same disk
+ * command.  Their contents go into the swap cache, a few kernel
+ * pages keyed by slot, and the fault that later loads one of them
+ * copies it from there instead of reading the disk.  The pages
+ * themselves stay in swap until then.
+ *
+ * The window, the number of pages read ahead, grows by one each time
+ * a cached page is used and halves each time one is dropped unused
+ * to make room, so it follows the hit rate.  A cache entry is
+ * dropped as soon as its slot is freed, so one that is reused never
+ * hands out stale contents; an entry whose read is still under way
+ * is only marked, and dropped when the read finishes. */
+#define SWAP_READAHEAD_MAX (SWAP_CLUSTER - 1)
+#define SWAP_CACHE_SIZE (2 * SWAP_CLUSTER)
+
+struct swap_cache_entry {
+	size_t slot;           /* Slot cached, or SWAP_SLOT_NONE if unused. */
+	void *kva;             /* Copy of the slot's contents, or NULL. */
+	bool ready;            /* Read finished? */
+	bool stale;            /* Slot freed while being read? */
+};
+
+static struct swap_cache_entry swap_cache[SWAP_CACHE_SIZE];
+static size_t swap_cache_hand;     /* Next entry to replace. */
+static size_t readahead_window = 1;
+static size_t readahead_cnt;       /* Pages read ahead. */
+static size_t readahead_hits;      /* Of those, pages used. */
+
+static bool swap_write_page (struct page *, const void *kva);
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	lock_init (&swap_lock);
+	swap_slots = bitmap_create (swap_disk != NULL
+			? disk_size (swap_disk) / SLOT_SECTORS : 0);
+	if (swap_slots == NULL)
+		PANIC ("swap: cannot allocate slot bitmap");
+	for (size_t i = 0; i < SWAP_CACHE_SIZE; i++)
+		swap_cache[i].slot = SWAP_SLOT_NONE;
+	phash_init (&shared_slots);
+	zswap_init (swap_write_page);
+}
+
+/* Allocates CNT contiguous swap slots and returns the first, or
+ * BITMAP_ERROR if there is no such run. */
+static size_t
+slot_alloc (size_t cnt) {
+	size_t slot;
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip_next_fit (swap_slots, &swap_cursor, cnt,
+			false);
+	lock_release (&swap_lock);
+	return slot;
+}
+
+/* Points SECTORS[0..SLOT_SECTORS) at the successive sectors of the
+ * page at KVA. */
+static void
+page_sectors (void *sectors[], const void *kva) {
+	for (size_t i = 0; i < SLOT_SECTORS; i++)
+		sectors[i] = (uint8_t *) kva + i * DISK_SECTOR_SIZE;
+}
+
+/* Returns the swap cache entry for SLOT, or NULL if there is none.
+ * SWAP_LOCK must be held. */
+static struct swap_cache_entry *
+swap_cache_find (size_t slot) {
+	for (size_t i = 0; i < SWAP_CACHE_SIZE; i++)
+		if (swap_cache[i].slot == slot && !swap_cache[i].stale)
+			return &swap_cache[i];
+	return NULL;
+}
+
+/* Drops a reference to SLOT, and returns it to the free swap space
+ * if that was the last. */
+static void
+slot_free (size_t slot) {
+	struct swap_cache_entry *e;
+	struct slot_share *share;
+
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot));
+	share = phash_find (&shared_slots, slot);
+	if (share != NULL && --share->ref_cnt > 0) {
+		lock_release (&swap_lock);
+		return;
+	}
+	if (share != NULL) {
+		phash_delete (&shared_slots, slot);
+		free (share);
+	}
+	bitmap_reset (swap_slots, slot);
+	e = swap_cache_find (slot);
+	if (e != NULL) {
+		if (e->ready)
+			e->slot = SWAP_SLOT_NONE;
+		else
+			e->stale = true;
+	}
+	lock_release (&swap_lock);
+}
+
+/* If the swap cache holds SLOT, copies its contents to KVA, drops
+ * the entry and returns true.  Otherwise returns false. */
+static bool
+swap_cache_take (size_t slot, void *kva) {
+	struct swap_cache_entry *e;
+
+	lock_acquire (&swap_lock);
+	e = swap_cache_find (slot);
+	if (e != NULL && e->ready) {
+		memcpy (kva, e->kva, PGSIZE);
+		e->slot = SWAP_SLOT_NONE;
+		readahead_hits++;
+		if (readahead_window < SWAP_READAHEAD_MAX)
+			readahead_window++;
+	} else
+		e = NULL;
+	lock_release (&swap_lock);
+	return e != NULL;
+}
+
+/* Reserves a swap cache entry for SLOT, to be read into, replacing
+ * the oldest finished one if all are in use.  Returns NULL if none
+ * can be had.  SWAP_LOCK must be held. */
+static struct swap_cache_entry *
+swap_cache_reserve (size_t slot) {
+	struct swap_cache_entry *e = NULL;
+
+	for (size_t i = 0; i < SWAP_CACHE_SIZE && e == NULL; i++)
+		if (swap_cache[i].slot == SWAP_SLOT_NONE)
+			e = &swap_cache[i];
+	for (size_t i = 0; i < SWAP_CACHE_SIZE && e == NULL; i++) {
+		struct swap_cache_entry *old = &swap_cache[swap_cache_hand];
+
+		swap_cache_hand = (swap_cache_hand + 1) % SWAP_CACHE_SIZE;
+		if (old->ready) {
+			/* Read ahead for nothing. */
+			readahead_window = readahead_window > 1
+				? readahead_window / 2 : 1;
+			e = old;
+		}
+	}
+	if (e == NULL)
+		return NULL;
+	if (e->kva == NULL && (e->kva = palloc_get_page (0)) == NULL) {
+		e->slot = SWAP_SLOT_NONE;
+		return NULL;
+	}
+	e->slot = slot;
+	e->ready = false;
+	e->stale = false;
+	return e;
+}
+
+/* Returns true if PAGE is an anonymous page whose contents are in
+ * swap SLOT and nowhere else. */
+static bool
+in_swap_slot (struct page *page, size_t slot) {
+	return page != NULL && page->operations == &anon_ops &&
+		page->frame == NULL && page->anon.zswap == NULL &&
+		page->anon.swap_slot == slot;
+}
+
+/* Reads PAGE's swap slot into KVA, along with the slots of the
+ * following pages of its process, as far as they are in the
+ * following slots and the readahead window allows, into the swap
+ * cache.  Uses a single disk command. */
+static void
+swap_read_ahead (struct page *page, void *kva) {
+	size_t slot = page->anon.swap_slot;
+	struct swap_cache_entry *ahead[SWAP_READAHEAD_MAX];
+	void *sectors[(SWAP_READAHEAD_MAX + 1) * SLOT_SECTORS];
+	size_t cnt = 0;
+
+	lock_acquire (&swap_lock);
+	while (cnt < readahead_window) {
+		size_t next = slot + cnt + 1;
+		void *va = (uint8_t *) page->va + (cnt + 1) * PGSIZE;
+
+		if (!is_user_vaddr (va) || next >= bitmap_size (swap_slots) ||
+				swap_cache_find (next) != NULL ||
+				!in_swap_slot (spt_find_page (page->spt, va), next) ||
+				(ahead[cnt] = swap_cache_reserve (next)) == NULL)
+			break;
+		cnt++;
+	}
+	lock_release (&swap_lock);
+
+	page_sectors (sectors, kva);
+	for (size_t i = 0; i < cnt; i++)
+		page_sectors (sectors + (i + 1) * SLOT_SECTORS, ahead[i]->kva);
+	disk_read_sectors (swap_disk, slot * SLOT_SECTORS,
+			(cnt + 1) * SLOT_SECTORS, sectors);
+
+	lock_acquire (&swap_lock);
+	for (size_t i = 0; i < cnt; i++) {
+		if (ahead[i]->stale)
+			ahead[i]->slot = SWAP_SLOT_NONE;
+		ahead[i]->ready = true;
+	}
+	readahead_cnt += cnt;
+	lock_release (&swap_lock);
+}
+
+/* Writes PAGE, whose contents are at KVA, to a swap slot of its
+ * own.  Returns false if swap is full. */
+static bool
+swap_write_page (struct page *page, const void *kva) {
+	void *sectors[SLOT_SECTORS];
+	size_t slot = slot_alloc (1);
+
+	if (slot == BITMAP_ERROR)
+		return false;
+	page_sectors (sectors, kva);
+	disk_write_sectors (swap_disk, slot * SLOT_SECTORS, SLOT_SECTORS,
+			(const void *const *) sectors);
+	page->anon.swap_slot = slot;
+	return true;
 }
 
 /* Initialize the file mapping */
 bool
-anon_initializer (struct page *page, enum vm_type type, void *kva) {
+anon_initializer (struct page *page, enum vm_type type UNUSED, void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	anon_page->zswap = NULL;
+	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk, or from the
+ * swap cache if it was read ahead. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (zswap_load (page, kva))
+		return true;
+	if (anon_page->swap_slot == SWAP_SLOT_NONE)
+		return false;
+
+	if (!swap_cache_take (anon_page->swap_slot, kva))
+		swap_read_ahead (page, kva);
+	slot_free (anon_page->swap_slot);
+	anon_page->swap_slot = SWAP_SLOT_NONE;
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	bool written;
+
+	anon_swap_out_cluster (&page, 1, &written);
+	return written;
+}
+
+/* Writes as many as it can of the CNT pages PAGES[IDX[0]],
+ * PAGES[IDX[1]], ... to contiguous swap slots with a single disk
+ * command, halving CNT until a free run that long is found.
+ * Returns the number written. */
+static size_t
+write_run (struct page *pages[], const size_t idx[], size_t cnt) {
+	void *sectors[SWAP_CLUSTER * SLOT_SECTORS];
+	size_t slot = BITMAP_ERROR;
+
+	for (; cnt > 0; cnt /= 2)
+		if ((slot = slot_alloc (cnt)) != BITMAP_ERROR)
+			break;
+	if (cnt == 0)
+		return 0;
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = pages[idx[i]];
+
+		page_sectors (sectors + i * SLOT_SECTORS, page->frame->kva);
+		page->anon.swap_slot = slot + i;
+	}
+	disk_write_sectors (swap_disk, slot * SLOT_SECTORS, cnt * SLOT_SECTORS,
+			(const void *const *) sectors);
+	return cnt;
+}
+
+/* Swaps out the CNT anonymous pages in PAGES, at most SWAP_CLUSTER.
+ * Each is first offered to the compressed pool; the rest are
+ * written to contiguous swap slots, with one disk command if there
+ * is a free run long enough for all of them.  Sets WRITTEN[I] to
+ * whether PAGES[I] was swapped out and returns how many were.  The
+ * pages keep their frames, which the caller must have unmapped and
+ * is responsible for releasing. */
+size_t
+anon_swap_out_cluster (struct page *pages[], size_t cnt, bool written[]) {
+	size_t disk_idx[SWAP_CLUSTER];
+	size_t disk_cnt = 0, done = 0;
+
+	ASSERT (cnt <= SWAP_CLUSTER);
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct anon_page *anon_page = &pages[i]->anon;
+
+		ASSERT (pages[i]->operations == &anon_ops);
+		ASSERT (anon_page->swap_slot == SWAP_SLOT_NONE);
+		written[i] = zswap_store (pages[i], pages[i]->frame->kva);
+		if (written[i])
+			done++;
+		else
+			disk_idx[disk_cnt++] = i;
+	}
+
+	for (size_t i = 0; i < disk_cnt; ) {
+		size_t run = write_run (pages, disk_idx + i, disk_cnt - i);
+
+		if (run == 0)
+			break;
+		for (size_t j = i; j < i + run; j++)
+			written[disk_idx[j]] = true;
+		i += run;
+		done += run;
+	}
+	return done;
+}
+
+/* Swaps out FRAME, an anonymous frame shared by several pages, by
+ * writing it to one swap slot that all of its pages then refer to.
+ * The compressed pool keeps one copy per page, so it is passed
+ * over.  Returns false if swap is full.  The pages keep the frame,
+ * which the caller must have unmapped from all of them and is
+ * responsible for releasing. */
+bool
+anon_swap_out_shared (struct frame *frame) {
+	struct slot_share *share = malloc (sizeof *share);
+	void *sectors[SLOT_SECTORS];
+	struct list_elem *e;
+	size_t slot;
+	bool ok;
+
+	if (share == NULL)
+		return false;
+	slot = slot_alloc (1);
+	if (slot == BITMAP_ERROR) {
+		free (share);
+		return false;
+	}
+	share->ref_cnt = frame->ref_cnt;
+	lock_acquire (&swap_lock);
+	ok = phash_insert (&shared_slots, slot, share);
+	lock_release (&swap_lock);
+	if (!ok) {
+		free (share);
+		slot_free (slot);
+		return false;
+	}
+
+	page_sectors (sectors, frame->kva);
+	disk_write_sectors (swap_disk, slot * SLOT_SECTORS, SLOT_SECTORS,
+			(const void *const *) sectors);
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		ASSERT (page->operations == &anon_ops);
+		ASSERT (page->anon.swap_slot == SWAP_SLOT_NONE);
+		page->anon.swap_slot = slot;
+	}
+	shared_evict_cnt++;
+	return true;
+}
+
+/* Prints statistics about swap readahead and shared frames. */
+void
+anon_print_stats (void) {
+	if (readahead_cnt != 0)
+		printf ("swap readahead: %zu pages read ahead, %zu used, "
+				"window %zu\n",
+				readahead_cnt, readahead_hits, readahead_window);
+	if (shared_evict_cnt != 0)
+		printf ("swap: %zu shared frames swapped out\n", shared_evict_cnt);
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* First, so that an eviction of PAGE under way finishes, and
+	 * its slot is freed below. */
+	vm_free_frame (page);
+	zswap_invalidate (page);
+	if (anon_page->swap_slot != SWAP_SLOT_NONE)
+		slot_free (anon_page->swap_slot);
 }
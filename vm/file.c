@@ -1,5 +1,15 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <stdlib.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
@@ -14,45 +24,407 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Write-back.
+ *
+ * Dirty pages of mapped files are written back in the background by
+ * the writeback thread, so that little is left to write when they
+ * are evicted or unmapped.  Every WRITEBACK_INTERVAL_MS it collects
+ * the dirty pages from the frame table, in batches of WRITEBACK_BATCH,
+ * and writes each batch sorted by file and offset.
+ *
+ * A page still dirty when it is unmapped, by munmap() or at exit,
+ * is not written then: its frame is detached and queued for the
+ * writeback thread, which writes and frees it within
+ * WRITEBACK_WAKE_MS.  Reads and writes of the file, and loads of
+ * its pages, call file_writeback_sync() first, so none of them sees
+ * the file older than the mapping left it.  At most
+ * WRITEBACK_MAX_QUEUED frames wait this way; past that, unmapping
+ * writes synchronously. */
+#define WRITEBACK_WAKE_MS 100
+#define WRITEBACK_INTERVAL_MS 1000
+#define WRITEBACK_BATCH 32
+#define WRITEBACK_MAX_QUEUED 64
+
+/* A detached frame waiting to be written back. */
+struct writeback {
+	struct list_elem elem;      /* In queued, or a batch being written. */
+	struct file *file;          /* File to write to, owned. */
+	off_t ofs;                  /* Offset in FILE. */
+	size_t len;                 /* Bytes to write. */
+	void *kva;                  /* The frame, owned. */
+};
+
+static struct lock writeback_lock;  /* Protects the rest. */
+static struct condition written;    /* A batch was written. */
+static struct list queued;          /* Frames not yet being written. */
+static size_t queued_cnt;           /* Frames queued or being written. */
+static bool writing;                /* A batch is being written? */
+static bool scan_requested;         /* Scan the frame table on next wake? */
+
+static void writeback_thread (void *aux UNUSED);
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	lock_init (&writeback_lock);
+	cond_init (&written);
+	list_init (&queued);
+	if (thread_create ("writeback", PRI_DEFAULT, writeback_thread, NULL)
+			== TID_ERROR)
+		PANIC ("cannot start writeback thread");
 }
 
-/* Initialize the file backed page */
-bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+/* Turns PAGE, an uninit VM_FILE page, into a file page, taking
+ * over the file_segment it was to be loaded from. */
+static void
+file_page_setup (struct page *page) {
+	struct file_segment *seg = page->uninit.aux;
+	bool text = (page->uninit.type & VM_TEXT) != 0;
+
+	ASSERT (seg != NULL);
+
 	/* Set up the handler */
 	page->operations = &file_ops;
+	page->file = (struct file_page) {
+		.file = seg->file,
+		.ofs = seg->ofs,
+		.read_bytes = seg->read_bytes,
+		.text = text,
+		.map = seg->map,
+	};
+	free (seg);
+}
 
-	struct file_page *file_page = &page->file;
+/* Initialize the file backed page */
+bool
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva) {
+	file_page_setup (page);
+	return file_backed_swap_in (page, kva);
+}
+
+/* Turns PAGE, an uninit VM_FILE page, into a file page that is not
+ * resident, without reading it, so that it can be mapped to a frame
+ * that already holds its contents. */
+void
+file_backed_prepare (struct page *page) {
+	ASSERT (VM_TYPE (page->operations->type) == VM_UNINIT);
+	file_page_setup (page);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (file_page->map != NULL)
+		file_writeback_sync (file_get_inode (file_page->file));
+	if (file_read_at (file_page->file, kva, file_page->read_bytes,
+				file_page->ofs) != (off_t) file_page->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + file_page->read_bytes, 0,
+			PGSIZE - file_page->read_bytes);
+	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  Pages that
+ * are not dirty are just dropped, to be read again.  The page is
+ * unmapped already, but its dirty bit is still in its PTE. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (page->writable && pml4_is_dirty (page->pml4, page->va))
+		return file_write_at (file_page->file, page->frame->kva,
+				file_page->read_bytes, file_page->ofs)
+			== (off_t) file_page->read_bytes;
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	struct writeback *wb = NULL;
+	void *kva = NULL;
+
+	/* Queue a dirty frame for the writeback thread, if there is
+	 * room, and let it close the file after writing. */
+	lock_acquire (&writeback_lock);
+	if (page->writable && queued_cnt < WRITEBACK_MAX_QUEUED
+			&& (wb = malloc (sizeof *wb)) != NULL
+			&& (kva = vm_take_dirty_frame (page)) != NULL) {
+		*wb = (struct writeback) {
+			.file = file_page->file,
+			.ofs = file_page->ofs,
+			.len = file_page->read_bytes,
+			.kva = kva,
+		};
+		list_push_back (&queued, &wb->elem);
+		queued_cnt++;
+	}
+	lock_release (&writeback_lock);
+	if (kva != NULL)
+		return;
+	free (wb);
+
+	kva = vm_writeback_begin (page);
+	if (kva != NULL) {
+		file_write_at (file_page->file, kva, file_page->read_bytes,
+				file_page->ofs);
+		vm_writeback_end (page);
+	}
+	vm_free_frame (page);
+	file_close (file_page->file);
+}
+
+/* Orders pages A and B, mapping files, by file and offset. */
+static int
+compare_file_pos (const void *a_, const void *b_) {
+	const struct page *a = *(struct page *const *) a_;
+	const struct page *b = *(struct page *const *) b_;
+	uintptr_t a_inode = (uintptr_t) file_get_inode (a->file.file);
+	uintptr_t b_inode = (uintptr_t) file_get_inode (b->file.file);
+
+	if (a_inode != b_inode)
+		return a_inode < b_inode ? -1 : 1;
+	return a->file.ofs < b->file.ofs ? -1 : a->file.ofs > b->file.ofs;
+}
+
+/* Writes back the dirty pages of mapped files that are resident. */
+static void
+write_dirty_pages (void) {
+	struct page *pages[WRITEBACK_BATCH];
+	size_t cnt;
+
+	do {
+		cnt = vm_writeback_gather (pages, WRITEBACK_BATCH);
+		qsort (pages, cnt, sizeof *pages, compare_file_pos);
+		for (size_t i = 0; i < cnt; i++) {
+			struct file_page *file_page = &pages[i]->file;
+
+			file_write_at (file_page->file, pages[i]->frame->kva,
+					file_page->read_bytes, file_page->ofs);
+			vm_writeback_end (pages[i]);
+		}
+	} while (cnt == WRITEBACK_BATCH);
+}
+
+/* Orders writebacks A and B by file and offset. */
+static bool
+writeback_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct writeback *a = list_entry (a_, struct writeback, elem);
+	const struct writeback *b = list_entry (b_, struct writeback, elem);
+	uintptr_t a_inode = (uintptr_t) file_get_inode (a->file);
+	uintptr_t b_inode = (uintptr_t) file_get_inode (b->file);
+
+	if (a_inode != b_inode)
+		return a_inode < b_inode;
+	return a->ofs < b->ofs;
+}
+
+/* Writes back the queued frames of INODE, or all of them if INODE
+ * is null, and frees them.  Batches are written one at a time, so
+ * once this returns, nothing of INODE is left to write.
+ * WRITEBACK_LOCK must be held; it is released while writing. */
+static void
+write_queued (struct inode *inode) {
+	struct list batch;
+	struct list_elem *e;
+	size_t cnt;
+
+	while (writing)
+		cond_wait (&written, &writeback_lock);
+
+	list_init (&batch);
+	for (e = list_begin (&queued); e != list_end (&queued); ) {
+		struct writeback *wb = list_entry (e, struct writeback, elem);
+
+		e = list_next (e);
+		if (inode == NULL || file_get_inode (wb->file) == inode) {
+			list_remove (&wb->elem);
+			list_insert_ordered (&batch, &wb->elem, writeback_less, NULL);
+		}
+	}
+	if (list_empty (&batch))
+		return;
+
+	cnt = list_size (&batch);
+	writing = true;
+	lock_release (&writeback_lock);
+	while (!list_empty (&batch)) {
+		struct writeback *wb = list_entry (list_pop_front (&batch),
+				struct writeback, elem);
+
+		file_write_at (wb->file, wb->kva, wb->len, wb->ofs);
+		palloc_free_page (wb->kva);
+		file_close (wb->file);
+		free (wb);
+	}
+	lock_acquire (&writeback_lock);
+
+	queued_cnt -= cnt;
+	writing = false;
+	cond_broadcast (&written, &writeback_lock);
+}
+
+/* Writes back now whatever is still queued for INODE, or for every
+ * file if INODE is null, from pages that were unmapped dirty. */
+void
+file_writeback_sync (struct inode *inode) {
+	lock_acquire (&writeback_lock);
+	if (queued_cnt > 0)
+		write_queued (inode);
+	lock_release (&writeback_lock);
+}
+
+/* The writeback thread. */
+static void
+writeback_thread (void *aux UNUSED) {
+	int64_t last_scan = timer_ticks ();
+
+	for (;;) {
+		bool scan;
+
+		timer_msleep (WRITEBACK_WAKE_MS);
+
+		lock_acquire (&writeback_lock);
+		write_queued (NULL);
+		scan = scan_requested
+			|| timer_elapsed (last_scan) >= WRITEBACK_INTERVAL_MS * TIMER_FREQ / 1000;
+		scan_requested = false;
+		lock_release (&writeback_lock);
+
+		if (scan) {
+			write_dirty_pages ();
+			last_scan = timer_ticks ();
+		}
+	}
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	off_t file_len = file_length (file);
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, (uint8_t *) addr + i * PGSIZE) != NULL)
+			return NULL;
+
+	/* The file may have pages left to write from an earlier
+	 * mapping. */
+	file_writeback_sync (file_get_inode (file));
+
+	for (i = 0; i < page_cnt; i++) {
+		void *upage = (uint8_t *) addr + i * PGSIZE;
+		off_t ofs = offset + i * PGSIZE;
+		struct file_segment *seg = malloc (sizeof *seg);
+
+		if (seg == NULL)
+			goto fail;
+		seg->file = file_reopen (file);
+		seg->ofs = ofs;
+		seg->read_bytes = ofs < file_len
+			? (file_len - ofs < PGSIZE ? file_len - ofs : PGSIZE) : 0;
+		seg->map = addr;
+		if (seg->file == NULL
+				|| !vm_alloc_page_with_initializer (VM_FILE, upage, writable,
+					NULL, seg)) {
+			file_close (seg->file);
+			free (seg);
+			goto fail;
+		}
+	}
+	return addr;
+
+fail:
+	do_munmap (addr);
+	return NULL;
+}
+
+/* Returns the start of the mapping PAGE belongs to, or NULL if it
+ * is not part of one. */
+static void *
+page_map (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			if (VM_TYPE (page->uninit.type) != VM_FILE)
+				return NULL;
+			return ((struct file_segment *) page->uninit.aux)->map;
+		case VM_FILE:
+			return page->file.map;
+		default:
+			return NULL;
+	}
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct thread *t = thread_current ();
+	uint8_t *upage = addr;
+	struct page *page;
+	struct tlb_gather tlb;
+
+	/* Flush the TLB and free the emptied page tables once, at the
+	 * end. */
+	tlb_gather_begin (&tlb, t->pml4);
+	while ((page = spt_find_page (&t->spt, upage)) != NULL
+			&& page_map (page) == addr) {
+		spt_remove_page (&t->spt, page);
+		upage += PGSIZE;
+	}
+	tlb_gather_free_tables (&tlb, addr, upage);
+	tlb_gather_end (&tlb);
+}
+
+/* Writes back the dirty pages of PAGE's mapping for do_msync().
+ * Returns false if PAGE is not part of a mapping. */
+static bool
+msync_page (struct page *page, void *aux UNUSED) {
+	void *kva;
+
+	if (page_map (page) == NULL)
+		return false;
+	if (VM_TYPE (page->operations->type) != VM_FILE)
+		return true;
+
+	kva = vm_writeback_begin (page);
+	if (kva != NULL) {
+		file_write_at (page->file.file, kva, page->file.read_bytes,
+				page->file.ofs);
+		vm_writeback_end (page);
+	}
+	return true;
+}
+
+/* Writes the mapped pages in [ADDR, ADDR + LENGTH) back to their
+ * files: with MS_SYNC, before returning; with MS_ASYNC, soon, by
+ * the writeback thread.  Returns false if the range is not all
+ * mapped from files. */
+bool
+do_msync (void *addr, size_t length, int flags) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *end = (uint8_t *) addr + length;
+	uint8_t *upage;
+
+	for (upage = addr; upage < end; upage += PGSIZE) {
+		struct page *page = spt_find_page (spt, upage);
+
+		if (page == NULL || page_map (page) == NULL)
+			return false;
+	}
+
+	if (flags & MS_SYNC)
+		return spt_for_each (spt, addr, end, msync_page, NULL);
+
+	lock_acquire (&writeback_lock);
+	scan_requested = true;
+	lock_release (&writeback_lock);
+	return true;
 }
@@ -0,0 +1,53 @@
+/* ksm.c: Kernel same-page merging daemon. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* ksmd wakes up every ksm_sleep_ms milliseconds and has
+ * vm_ksm_scan() look at the next ksm_pages_per_pass anonymous
+ * frames, merging those with identical contents.  Together the two
+ * set the scan rate.  It runs at the lowest priority, so that it
+ * only takes time the processes leave over. */
+unsigned ksm_pages_per_pass;
+unsigned ksm_sleep_ms = 20;
+
+/* Statistics. */
+static size_t pass_cnt, scan_cnt, merge_cnt;
+static int64_t scan_ticks;
+
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		int64_t start;
+
+		timer_msleep (ksm_sleep_ms);
+		start = timer_ticks ();
+		scan_cnt += vm_ksm_scan (ksm_pages_per_pass, &merge_cnt);
+		scan_ticks += timer_elapsed (start);
+		pass_cnt++;
+	}
+}
+
+/* Starts ksmd, if it is enabled. */
+void
+ksm_init (void) {
+	if (ksm_pages_per_pass > 0
+			&& thread_create ("ksmd", PRI_MIN, ksmd, NULL) == TID_ERROR)
+		PANIC ("ksm: cannot start ksmd");
+}
+
+/* Prints ksmd statistics. */
+void
+ksm_print_stats (void) {
+	if (ksm_pages_per_pass == 0)
+		return;
+
+	printf ("ksm: %zu passes, %zu pages scanned, %zu merged, "
+			"%"PRId64" ticks scanning\n",
+			pass_cnt, scan_cnt, merge_cnt, scan_ticks);
+}
@@ -0,0 +1,52 @@
+/* thp.c: Transparent huge page collapse daemon. */
+
+#include "vm/thp.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* khugepaged wakes up every thp_sleep_ms milliseconds and has
+ * vm_thp_collapse() collapse up to COLLAPSE_PER_PASS regions whose
+ * pages have all become resident into huge pages.  It runs at the
+ * lowest priority, so that it only takes time the processes leave
+ * over. */
+#define COLLAPSE_PER_PASS 4
+
+bool thp_enabled;
+unsigned thp_sleep_ms = 1000;
+
+/* Statistics. */
+static size_t pass_cnt, collapse_cnt;
+
+static void
+khugepaged (void *aux UNUSED) {
+	for (;;) {
+		timer_msleep (thp_sleep_ms);
+		collapse_cnt += vm_thp_collapse (COLLAPSE_PER_PASS);
+		pass_cnt++;
+	}
+}
+
+/* Starts khugepaged, if huge pages are enabled. */
+void
+thp_init (void) {
+	if (thp_enabled
+			&& thread_create ("khugepaged", PRI_MIN, khugepaged, NULL)
+			== TID_ERROR)
+		PANIC ("thp: cannot start khugepaged");
+}
+
+/* Prints huge page statistics. */
+void
+thp_print_stats (void) {
+	size_t faults, splits;
+
+	if (!thp_enabled)
+		return;
+
+	vm_thp_stats (&faults, &splits);
+	printf ("thp: %zu mapped on fault, %zu collapsed in %zu passes, "
+			"%zu split\n", faults, collapse_cnt, pass_cnt, splits);
+}
@@ -8,6 +8,9 @@
  * function.
  * */
 
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/uninit.h"
 
@@ -51,7 +54,10 @@ uninit_initialize (struct page *page, void *kva) {
 	vm_initializer *init = uninit->init;
 	void *aux = uninit->aux;
 
-	/* TODO: You may need to fix this function. */
+	/* Pages without an initializer start out zeroed. */
+	if (init == NULL)
+		memset (kva, 0, PGSIZE);
+
 	return uninit->page_initializer (page, uninit->type, kva) &&
 		(init ? init (page, aux) : true);
 }
@@ -62,7 +68,16 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: Fill this function.
-	 * TODO: If you don't have anything to do, just return. */
+	struct uninit_page *uninit = &page->uninit;
+
+	/* The page may be mapped to the zero page. */
+	vm_free_frame (page);
+
+	/* The only AUX we pass with an initializer is the struct
+	 * file_segment to load from, which the page owns. */
+	struct file_segment *seg = uninit->aux;
+	if (seg != NULL) {
+		file_close (seg->file);
+		free (seg);
+	}
 }
@@ -1,8 +1,151 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/thp.h"
+
+/* Global frame table.
+ *
+ * Every frame holding a user page is on one of two clocks, managed
+ * with CLOCK-Pro.  Frames start out cold, in a test period; a cold
+ * frame whose page is referenced again during its test period is
+ * promoted to hot.  Eviction takes only cold frames, so a large
+ * sequential scan cycles through the cold clock without pushing the
+ * hot working set out.  A page evicted during its test period stays
+ * on the non-resident test list, and a fault on it while it is
+ * there is a sign that the cold clock is too small: the cold target
+ * grows and the page comes back hot.  A test period that expires
+ * without a fault shrinks the cold target.  The hot clock is
+ * trimmed to what the cold target leaves over.
+ *
+ * References are taken from the accessed bits in the page tables,
+ * which each pass of a hand samples and clears.  Among cold frames
+ * that have not been referenced, the cold hand prefers clean ones,
+ * since evicting them needs no write-back. */
+/* 전역 프레임 테이블. CLOCK-Pro로 hot/cold 두 개의 시계를 관리합니다. */
+static struct lock frame_lock;
+static struct condition writeback_done; /* A write-back finished. */
+static struct list hot_frames;  /* Hot frames, in clock order. */
+static struct list cold_frames; /* Cold frames, in clock order. */
+static struct list test_pages;  /* Evicted pages in their test period,
+								   oldest first. */
+static size_t hot_cnt, cold_cnt, test_cnt;
+static size_t cold_target;      /* Adaptive target number of cold frames. */
+
+/* Text cache.
+ *
+ * Frames holding read-only pages of executables, keyed by the file
+ * position of their contents.  A VM_TEXT page that is not resident
+ * looks here before reading its file, so all the processes running
+ * a program share one copy of its text, and exec of a program that
+ * is already running maps it without faults or disk reads.  A frame
+ * leaves the cache when its last page is unmapped; since each page
+ * holds its file open, the inode in a key stays valid meanwhile.
+ * Protected by FRAME_LOCK. */
+static struct hash text_cache;
+
+/* A page of zeros, mapped read-only for reads of anonymous pages
+ * that were never written, such as untouched BSS.  Such a page gets
+ * a frame of its own only when it is first written.  The zero page
+ * is not a frame: it is never evicted or freed. */
+static void *zero_page;
+
+/* Same-page merging.
+ *
+ * ksmd (see vm/ksm.c) calls vm_ksm_scan() to find anonymous frames
+ * with identical contents and merge them into one frame, shared
+ * copy-on-write like a frame after fork.  Each frame scanned is
+ * indexed by a hash of its contents, and one whose hash is indexed
+ * for another frame already is compared with it byte for byte.
+ * Hashing is done without FRAME_LOCK, a batch of frames at a time,
+ * with the frames pinned so that they are not evicted, merged or
+ * collapsed meanwhile; a frame freed meanwhile is left for the
+ * scanner to free.  Both frames are write-protected before the
+ * comparison, so neither can change between it and the merge: a
+ * write meanwhile faults and waits for FRAME_LOCK in vm_handle_wp(),
+ * which then hands out write access again, or a private copy if the
+ * merge went through.  If they differ, write access is restored at
+ * once.  A frame leaves the index when it is freed or evicted.  A
+ * frame written since it was indexed stays under its old hash until
+ * it is scanned again, and just fails to compare equal meanwhile.
+ * Protected by FRAME_LOCK. */
+#define KSM_BATCH 16
+static struct phash ksm_index;  /* Hash of contents to frame. */
+static unsigned ksm_round;      /* Full scans started. */
+
+/* Resident set limits.
+ *
+ * Each process's resident set size, the number of its pages mapped
+ * to frames, is counted in its SPT as pages are mapped and unmapped;
+ * a frame shared by several processes counts for each of them.  The
+ * working set is estimated by sampling: at most once per WS_WINDOW,
+ * a page fault walks the faulting process's resident pages and counts
+ * those accessed since the last sample, taking FRAME_LOCK for
+ * WS_SAMPLE_BATCH pages at a time.  The sampler and the hands both
+ * clear accessed bits, so each leaves what it took behind for the
+ * other, in the page's WS_REF and the frame's REFERENCED.
+ *
+ * Under memory pressure, the cold hand first looks for a victim among
+ * the frames of processes over the soft limit, preferring those that
+ * hold more than their working set, within the SOFT_SCAN_MAX frames
+ * it would reach next; it does not look at all while no process is
+ * over the limit.  A process at the hard limit evicts one of its own
+ * pages for each one it loads, whether or not memory is short. */
+#define WS_WINDOW TIMER_FREQ
+#define WS_SAMPLE_BATCH 64
+#define SOFT_SCAN_MAX 64
+
+unsigned rss_soft_limit;
+unsigned rss_hard_limit;
+static size_t soft_over_cnt;    /* Processes over the soft limit. */
+static size_t soft_evict_cnt;   /* Victims taken for the soft limit. */
+static size_t hard_evict_cnt;   /* Victims taken for the hard limit. */
+
+/* Transparent huge pages.
+ *
+ * With thp_enabled, a write fault on a zero-fill anonymous page in a
+ * 2 MB aligned region made up entirely of such pages loads the whole
+ * region into 2 MB of contiguous frames and maps it with a single
+ * page directory entry, so that touching it takes one fault and one
+ * TLB entry rather than 512.  khugepaged (see vm/thp.c) calls
+ * vm_thp_collapse() to do the same for regions whose pages became
+ * resident one by one, by copying them into such a block.  It looks
+ * through other processes' SPTs, so it holds each one's lock while
+ * it does.
+ *
+ * Each page of a huge page keeps a frame of its own in the frame
+ * table, so the hands age and evict its pages one at a time.
+ * Anything that changes the mapping of one of them, such as evicting
+ * or freeing it or sharing it after fork, first splits the huge page
+ * back into small ones, with the page table the region had before,
+ * which is kept for the purpose so that splitting cannot fail.  A
+ * huge page is never shared or merged.  Its accessed and dirty bits
+ * cover all of it, so until it is split its pages look alike to the
+ * hands: whoever first finds the accessed bit set clears it and
+ * passes the reference on to every page of the huge page, rather
+ * than leaving the other 511 looking cold.  Protected by
+ * FRAME_LOCK. */
+struct thp
+{
+	void *va;                        /* First user virtual address. */
+	uint64_t *pml4;                  /* Page map it is installed in. */
+	uint64_t *pt;                    /* Page table to split it into. */
+	struct frame *frames[LPG_PAGES]; /* Its frames, in address order. */
+};
+
+static size_t thp_fault_cnt;    /* Huge pages mapped on fault. */
+static size_t thp_split_cnt;    /* Huge pages split. */
+
+static hash_hash_func text_hash;
+static hash_less_func text_less;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -15,7 +158,17 @@ void vm_init(void)
 #endif
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	lock_init(&frame_lock);
+	cond_init(&writeback_done);
+	list_init(&hot_frames);
+	list_init(&cold_frames);
+	list_init(&test_pages);
+	cold_target = 1;
+	hash_init(&text_cache, text_hash, text_less, NULL);
+	zero_page = palloc_get_page(PAL_ZERO | PAL_ASSERT);
+	phash_init(&ksm_index);
+	ksm_init();
+	thp_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -34,10 +187,65 @@ page_get_type(struct page *page)
 	}
 }
 
+/* How claim_page() may get a frame. */
+enum claim_flags
+{
+	CLAIM_PIN = 1,      /* Pin the frame. */
+	CLAIM_NO_EVICT = 2, /* Fail rather than evict another page. */
+	CLAIM_CACHED = 4,   /* Only map a frame from the text cache. */
+};
+
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
-static struct frame *vm_evict_frame(void);
+static bool claim_page(struct page *page, enum claim_flags flags);
+static struct frame *vm_evict_frame(struct supplemental_page_table *owner);
+
+/* Lowest address the stack may grow down to. */
+#define STACK_LIMIT (USER_STACK - (1 << 20))
+
+/* Returns the index of VA in a level-LEVEL node of the SPT radix
+ * tree.  Level 0 is indexed like the PML4 and level 3 like a page
+ * table. */
+static inline size_t
+spt_index(const void *va, int level)
+{
+	return ((uint64_t)va >> (PML4SHIFT - level * 9)) & (SPT_FANOUT - 1);
+}
+
+/* Returns the leaf slot of SPT for VA, or NULL if the nodes on the
+ * way to it do not exist.  If CREATE is true, missing nodes are
+ * allocated, and NULL is returned only if that fails. */
+static struct page **
+spt_slot(struct supplemental_page_table *spt, const void *va, bool create)
+{
+	void **node;
+
+	if (spt->root == NULL)
+	{
+		if (!create || (node = palloc_get_page(PAL_ZERO)) == NULL)
+			return NULL;
+		barrier();
+		spt->root = node;
+	}
+
+	node = spt->root;
+	for (int level = 0; level < SPT_LEVELS - 1; level++)
+	{
+		void **next = node[spt_index(va, level)];
+
+		if (next == NULL)
+		{
+			if (!create || (next = palloc_get_page(PAL_ZERO)) == NULL)
+				return NULL;
+			/* Publish the node only once it is zeroed. */
+			barrier();
+			node[spt_index(va, level)] = next;
+		}
+		node = next;
+	}
+	return (struct page **)&node[spt_index(va, SPT_LEVELS - 1)];
+}
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -47,17 +255,43 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 {
 
 	ASSERT(VM_TYPE(type) != VM_UNINIT)
+	ASSERT(pg_ofs(upage) == 0);
 
 	struct supplemental_page_table *spt = &thread_current()->spt;
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page(spt, upage) == NULL)
 	{
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+		bool (*initializer)(struct page *, enum vm_type, void *);
+		struct page *page;
+
+		switch (VM_TYPE(type))
+		{
+		case VM_ANON:
+			initializer = anon_initializer;
+			break;
+		case VM_FILE:
+			initializer = file_backed_initializer;
+			break;
+		default:
+			goto err;
+		}
+
+		page = malloc(sizeof *page);
+		if (page == NULL)
+			goto err;
 
-		/* TODO: Insert the page into the spt. */
+		uninit_new(page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->pml4 = thread_current()->pml4;
+		page->spt = spt;
+
+		if (!spt_insert_page(spt, page))
+		{
+			free(page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -65,139 +299,2318 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
+spt_find_page(struct supplemental_page_table *spt, void *va)
 {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+	struct page **slot;
+
+	if (!is_user_vaddr(va))
+		return NULL;
 
-	return page;
+	slot = spt_slot(spt, pg_round_down(va), false);
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
-bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
-					 struct page *page UNUSED)
+bool spt_insert_page(struct supplemental_page_table *spt,
+					 struct page *page)
 {
-	int succ = false;
-	/* TODO: Fill this function. */
+	struct page **slot;
+	bool success = false;
 
-	return succ;
+	if (!is_user_vaddr(page->va))
+		return false;
+
+	lock_acquire(&spt->lock);
+	slot = spt_slot(spt, page->va, true);
+	if (slot != NULL && *slot == NULL)
+	{
+		*slot = page;
+		spt->page_cnt++;
+		success = true;
+	}
+	lock_release(&spt->lock);
+	return success;
 }
 
+/* Removes PAGE from SPT and frees it. */
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
 {
+	struct page **slot = spt_slot(spt, page->va, false);
+
+	ASSERT(slot != NULL && *slot == page);
+
+	/* Unlink first, so lookups never see a freed page.  Freeing may
+	 * take the frame lock, so it is done without SPT's. */
+	lock_acquire(&spt->lock);
+	*slot = NULL;
+	spt->page_cnt--;
+	lock_release(&spt->lock);
 	vm_dealloc_page(page);
+}
+
+/* Calls ACTION for each page of NODE, a level-LEVEL node covering
+ * the addresses from BASE, that lies in [START, END).  Stops and
+ * returns false as soon as ACTION does. */
+static bool
+spt_walk(void **node, int level, uint64_t base, uint64_t start, uint64_t end,
+		 spt_action_func *action, void *aux)
+{
+	int shift = PML4SHIFT - level * 9;
+	size_t first = start > base ? (start - base) >> shift : 0;
+	size_t last = (end - 1 - base) >> shift;
+
+	if (last >= SPT_FANOUT)
+		last = SPT_FANOUT - 1;
+
+	for (size_t i = first; i <= last; i++)
+	{
+		void *child = node[i];
+
+		if (child == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+		{
+			if (!action(child, aux))
+				return false;
+		}
+		else if (!spt_walk(child, level + 1, base + ((uint64_t)i << shift),
+						   start, end, action, aux))
+			return false;
+	}
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
-static struct frame *
-vm_get_victim(void)
+/* Calls ACTION for each page in SPT whose address lies in
+ * [START, END), in address order, given auxiliary data AUX.
+ * Only the nodes covering mapped pages are visited.  ACTION may
+ * remove the page it is given, but must not insert pages.  Returns
+ * false if ACTION stopped the iteration, true otherwise. */
+bool spt_for_each(struct supplemental_page_table *spt, void *start, void *end,
+				  spt_action_func *action, void *aux)
 {
-	struct frame *victim = NULL;
-	/* TODO: The policy for eviction is up to you. */
+	if (spt->root == NULL || start >= end)
+		return true;
+	return spt_walk(spt->root, 0, 0, (uint64_t)start, (uint64_t)end,
+					action, aux);
+}
 
-	return victim;
+/* If the huge page THP was accessed, clears its accessed bit and
+ * records the reference on each of its frames and pages instead, so
+ * that each of them sees it once.  FRAME_LOCK must be held. */
+static void
+thp_take_accessed(struct thp *thp)
+{
+	if (!pml4_is_accessed(thp->pml4, thp->va))
+		return;
+	pml4_set_accessed(thp->pml4, thp->va, false);
+	for (size_t i = 0; i < LPG_PAGES; i++)
+	{
+		thp->frames[i]->referenced = true;
+		thp->frames[i]->page->ws_ref = true;
+	}
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
-static struct frame *
-vm_evict_frame(void)
+/* Returns true if FRAME was referenced through any of its pages
+ * since the last time this was called for it, and clears their
+ * accessed bits. */
+static bool
+frame_referenced(struct frame *frame)
 {
-	struct frame *victim UNUSED = vm_get_victim();
-	/* TODO: swap out the victim and return the evicted frame. */
+	bool accessed;
+	struct list_elem *e;
 
-	return NULL;
+	if (frame->thp != NULL)
+		thp_take_accessed(frame->thp);
+	accessed = frame->referenced;
+	frame->referenced = false;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		if (pml4_is_accessed(page->pml4, page->va))
+		{
+			pml4_set_accessed(page->pml4, page->va, false);
+			page->ws_ref = true;
+			accessed = true;
+		}
+	}
+	return accessed;
 }
 
-/* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
-static struct frame *
-vm_get_frame(void)
+/* Returns true if frame_referenced() would, without clearing
+ * anything. */
+static bool
+frame_accessed(struct frame *frame)
 {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+	struct list_elem *e;
 
-	ASSERT(frame != NULL);
-	ASSERT(frame->page == NULL);
-	return frame;
+	if (frame->referenced)
+		return true;
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		if (pml4_is_accessed(page->pml4, page->va))
+			return true;
+	}
+	return false;
 }
 
-/* Growing the stack. */
+/* Returns true if FRAME was written through any of its pages. */
+static bool
+frame_dirty(struct frame *frame)
+{
+	struct list_elem *e;
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		if (pml4_is_dirty(page->pml4, page->va))
+			return true;
+	}
+	return false;
+}
+
+/* A working-set sample in progress. */
+struct ws_sample
+{
+	size_t cnt;     /* Pages accessed since the last sample. */
+	size_t left;    /* Pages to visit before dropping FRAME_LOCK. */
+	void *next;     /* Where to go on from then. */
+};
+
+/* Counts PAGE in AUX, a struct ws_sample, if it is resident and was
+ * accessed since the last sample.  Stops at PAGE instead if the
+ * batch is done. */
+static bool
+ws_sample_page(struct page *page, void *aux)
+{
+	struct ws_sample *s = aux;
+
+	if (s->left == 0)
+	{
+		s->next = page->va;
+		return false;
+	}
+	s->left--;
+	if (page->frame == NULL)
+		return true;
+	if (page->frame->thp != NULL)
+		thp_take_accessed(page->frame->thp);
+	if (pml4_is_accessed(page->pml4, page->va))
+	{
+		pml4_set_accessed(page->pml4, page->va, false);
+		page->frame->referenced = true;
+		page->ws_ref = true;
+	}
+	if (page->ws_ref)
+	{
+		page->ws_ref = false;
+		s->cnt++;
+	}
+	return true;
+}
+
+/* Estimates the working set of SPT, the current process's table, if
+ * a sample window has passed since the last estimate. */
 static void
-vm_stack_growth(void *addr UNUSED)
+ws_sample(struct supplemental_page_table *spt)
 {
+	int64_t now = timer_ticks();
+	struct ws_sample s = {.cnt = 0, .next = NULL};
+	bool done;
+
+	if (now - spt->ws_sampled < WS_WINDOW)
+		return;
+
+	/* SPT is the current process's, so it does not change while
+	 * FRAME_LOCK is dropped between batches. */
+	do
+	{
+		s.left = WS_SAMPLE_BATCH;
+		lock_acquire(&frame_lock);
+		done = spt_for_each(spt, s.next, (void *)USER_STACK, ws_sample_page,
+							&s);
+		lock_release(&frame_lock);
+	} while (!done);
+	spt->wss = s.cnt;
+	spt->ws_sampled = now;
 }
 
-/* Handle the fault on write_protected page */
+/* Returns true if the process with SPT is over the soft RSS
+ * limit. */
 static bool
-vm_handle_wp(struct page *page UNUSED)
+over_soft_limit(const struct supplemental_page_table *spt)
 {
+	return rss_soft_limit > 0 && spt->rss > rss_soft_limit;
 }
 
-/* Return true on success */
-bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
-						 bool user UNUSED, bool write UNUSED, bool not_present UNUSED)
+/* Returns true if the process with SPT is at the hard RSS limit. */
+static bool
+at_hard_limit(const struct supplemental_page_table *spt)
+{
+	return rss_hard_limit > 0 && spt->rss >= rss_hard_limit;
+}
+
+/* Adds FRAME to the back of the list for STATE.  FRAME must not be
+ * on a list. */
+static void
+frame_push(struct frame *frame, enum frame_state state)
 {
-	struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+	ASSERT(frame->state == FRAME_UNLISTED);
 
-	return vm_do_claim_page(page);
+	frame->state = state;
+	if (state == FRAME_HOT)
+	{
+		list_push_back(&hot_frames, &frame->clock_elem);
+		hot_cnt++;
+	}
+	else
+	{
+		list_push_back(&cold_frames, &frame->clock_elem);
+		cold_cnt++;
+	}
 }
 
-/* Free the page.
- * DO NOT MODIFY THIS FUNCTION. */
-void vm_dealloc_page(struct page *page)
+/* Removes FRAME from the list it is on, if any. */
+static void
+frame_unlink(struct frame *frame)
 {
-	destroy(page);
-	free(page);
+	if (frame->state == FRAME_HOT)
+		hot_cnt--;
+	else if (frame->state == FRAME_COLD)
+		cold_cnt--;
+	else
+		return;
+	list_remove(&frame->clock_elem);
+	frame->state = FRAME_UNLISTED;
 }
 
-/* Claim the page that allocate on VA. */
-bool vm_claim_page(void *va UNUSED)
+/* Keeps the cold target between 1 and all resident frames but one. */
+static void
+clamp_cold_target(void)
 {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+	size_t resident = hot_cnt + cold_cnt;
 
-	return vm_do_claim_page(page);
+	if (cold_target + 1 > resident)
+		cold_target = resident > 1 ? resident - 1 : 1;
+	if (cold_target < 1)
+		cold_target = 1;
 }
 
-/* Claim the PAGE and set up the mmu. */
+/* Runs the hot hand until it demotes one frame to cold: referenced
+ * hot frames have their bit cleared and stay hot, and the first
+ * unreferenced one becomes cold, outside any test period. */
+static void
+run_hot_hand(void)
+{
+	/* Every frame passed is cleared, so two rounds suffice. */
+	size_t limit = 2 * hot_cnt;
+
+	for (size_t i = 0; i <= limit && hot_cnt > 0; i++)
+	{
+		struct frame *f = list_entry(list_front(&hot_frames), struct frame,
+									 clock_elem);
+
+		frame_unlink(f);
+		if (frame_referenced(f) && i < limit)
+			frame_push(f, FRAME_HOT);
+		else
+		{
+			f->test = false;
+			frame_push(f, FRAME_COLD);
+			return;
+		}
+	}
+}
+
+/* Demotes hot frames until the hot clock fits beside the cold
+ * target. */
+static void
+balance_hot(void)
+{
+	size_t resident;
+
+	clamp_cold_target();
+	resident = hot_cnt + cold_cnt;
+	while (hot_cnt > 0 && resident > cold_target &&
+		   hot_cnt > resident - cold_target)
+		run_hot_hand();
+}
+
+/* Puts PAGE, just evicted in its test period, on the non-resident
+ * test list.  The oldest entry expires once the list holds as many
+ * pages as there are resident frames. */
+static void
+test_push(struct page *page)
+{
+	page->in_test = true;
+	list_push_back(&test_pages, &page->test_elem);
+	test_cnt++;
+
+	if (test_cnt > hot_cnt + cold_cnt)
+	{
+		struct page *old = list_entry(list_pop_front(&test_pages),
+									  struct page, test_elem);
+
+		old->in_test = false;
+		test_cnt--;
+		if (cold_target > 1)
+			cold_target--;
+	}
+}
+
+/* Removes PAGE from the non-resident test list, if it is there.
+ * Returns true if it was. */
 static bool
-vm_do_claim_page(struct page *page)
+test_remove(struct page *page)
 {
-	struct frame *frame = vm_get_frame();
+	if (!page->in_test)
+		return false;
+	list_remove(&page->test_elem);
+	page->in_test = false;
+	test_cnt--;
+	return true;
+}
 
-	/* Set links */
-	frame->page = page;
+/* Takes FRAME out of the merge index.  FRAME_LOCK must be held. */
+static void
+ksm_forget(struct frame *frame)
+{
+	if (frame->ksm_indexed && phash_find(&ksm_index, frame->ksm_hash) == frame)
+		phash_delete(&ksm_index, frame->ksm_hash);
+	frame->ksm_indexed = false;
+}
+
+/* Maps PAGE to FRAME, as one more page sharing it.  FRAME_LOCK must
+ * be held. */
+static void
+frame_add_page(struct frame *frame, struct page *page)
+{
+	list_push_back(&frame->pages, &page->frame_elem);
+	frame->ref_cnt++;
+	if (++page->spt->rss == (size_t)rss_soft_limit + 1 && rss_soft_limit > 0)
+		soft_over_cnt++;
+	frame->page = list_entry(list_front(&frame->pages), struct page,
+							 frame_elem);
 	page->frame = frame;
+}
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+/* Detaches PAGE from FRAME and returns the number of pages still
+ * sharing FRAME.  FRAME_LOCK must be held. */
+static size_t
+frame_remove_page(struct frame *frame, struct page *page)
+{
+	ASSERT(page->frame == frame);
 
-	return swap_in(page, frame->kva);
+	list_remove(&page->frame_elem);
+	page->frame = NULL;
+	frame->ref_cnt--;
+	if (page->spt->rss-- == (size_t)rss_soft_limit + 1 && rss_soft_limit > 0)
+		soft_over_cnt--;
+	frame->page = frame->ref_cnt > 0
+					  ? list_entry(list_front(&frame->pages), struct page,
+								   frame_elem)
+					  : NULL;
+	return frame->ref_cnt;
 }
 
-/* Initialize new supplemental page table */
-/* 새 보조 페이지 테이블 초기화 */
-void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
+/* Maps the pages of huge page THP with small pages again and frees
+ * THP.  FRAME_LOCK must be held. */
+static void
+thp_split(struct thp *thp)
 {
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	pml4_split_large_page(thp->pml4, thp->va, thp->pt);
+	for (size_t i = 0; i < LPG_PAGES; i++)
+		thp->frames[i]->thp = NULL;
+	free(thp);
+	thp_split_cnt++;
 }
 
-/* Copy supplemental page table from src to dst */
-bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
-								  struct supplemental_page_table *src UNUSED)
+/* Splits the huge page FRAME is part of, if any, so that its page
+ * can be mapped on its own.  FRAME_LOCK must be held. */
+static void
+frame_split(struct frame *frame)
 {
+	if (frame->thp != NULL)
+		thp_split(frame->thp);
 }
 
-/* Free the resource hold by the supplemental page table */
-/* 보조 페이지 테이블로 리소스 보유를 해제합니다. */
-void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)
+/* If PAGE is read from a file, stores where from in POS's INODE,
+ * OFS and READ_BYTES and returns true.  Otherwise returns false. */
+static bool
+page_file_pos(struct page *page, struct frame *pos)
+{
+	struct file_segment *seg;
+
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+		seg = page->uninit.aux;
+		if (seg == NULL)
+			return false;
+		pos->inode = file_get_inode(seg->file);
+		pos->ofs = seg->ofs;
+		pos->read_bytes = seg->read_bytes;
+		return true;
+	case VM_FILE:
+		pos->inode = file_get_inode(page->file.file);
+		pos->ofs = page->file.ofs;
+		pos->read_bytes = page->file.read_bytes;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Returns true if PAGE is a VM_TEXT page. */
+static bool
+is_text_page(struct page *page)
+{
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+		return (page->uninit.type & VM_TEXT) != 0;
+	case VM_FILE:
+		return page->file.text;
+	default:
+		return false;
+	}
+}
+
+/* Returns a hash of text cache frame E's key. */
+static uint64_t
+text_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	const struct frame *f = hash_entry(e, struct frame, text_elem);
+
+	return hash_ptr((uintptr_t)f->inode) ^ hash_int(f->ofs);
+}
+
+/* Orders text cache frames A and B by key. */
+static bool
+text_less(const struct hash_elem *a_, const struct hash_elem *b_,
+		  void *aux UNUSED)
+{
+	const struct frame *a = hash_entry(a_, struct frame, text_elem);
+	const struct frame *b = hash_entry(b_, struct frame, text_elem);
+
+	if (a->inode != b->inode)
+		return (uintptr_t)a->inode < (uintptr_t)b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Maps PAGE, a VM_TEXT page, read-only to the frame in the text
+ * cache that holds its contents, and returns that frame.  Returns
+ * NULL if there is none or mapping fails.  FRAME_LOCK must be
+ * held. */
+static struct frame *
+text_cache_map(struct page *page)
+{
+	struct frame key;
+	struct hash_elem *e;
+	struct frame *frame;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	page_file_pos(page, &key);
+	e = hash_find(&text_cache, &key.text_elem);
+	if (e == NULL)
+		return NULL;
+	frame = hash_entry(e, struct frame, text_elem);
+	if (!pml4_set_page(page->pml4, page->va, frame->kva, false))
+		return NULL;
+	test_remove(page);
+	frame_add_page(frame, page);
+	return frame;
+}
+
+/* Unmaps all the pages sharing FRAME, which is in the text cache,
+ * and takes it out of the cache.  Its contents are still in the
+ * file, so nothing is written.  FRAME_LOCK must be held. */
+static void
+text_cache_evict(struct frame *frame)
+{
+	struct page *first = frame->page;
+	struct list_elem *e;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		pml4_clear_page(page->pml4, page->va);
+	}
+	while (frame->ref_cnt > 0)
+		frame_remove_page(frame, frame->page);
+	if (frame->test)
+		test_push(first);
+	hash_delete(&text_cache, &frame->text_elem);
+	frame->inode = NULL;
+}
+
+/* Adds FRAME, just filled with its page, to the frame table, and to
+ * the text cache if the page is a VM_TEXT page.  If the cache has
+ * a frame for the same contents already, loaded meanwhile by
+ * another process, FRAME stays private to its page. */
+static void
+frame_table_insert(struct frame *frame)
+{
+	lock_acquire(&frame_lock);
+	if (is_text_page(frame->page))
+	{
+		page_file_pos(frame->page, frame);
+		if (hash_insert(&text_cache, &frame->text_elem) != NULL)
+			frame->inode = NULL;
+	}
+	if (test_remove(frame->page))
+	{
+		/* Faulted back in during its test period: the cold clock
+		 * is too small to hold this page's reuse distance. */
+		cold_target++;
+		frame_push(frame, FRAME_HOT);
+		balance_hot();
+	}
+	else
+	{
+		frame->test = true;
+		frame_push(frame, FRAME_COLD);
+	}
+	lock_release(&frame_lock);
+}
+
+/* Returns true if FRAME may be evicted for its owner's RSS limit:
+ * it is mapped by one page only, so that evicting it takes nothing
+ * from other processes, and is neither pinned nor being written
+ * back. */
+static bool
+frame_limit_evictable(const struct frame *frame)
+{
+	return frame->ref_cnt == 1 && frame->pin_cnt == 0 && !frame->writeback;
+}
+
+/* Looks for a victim among the first SOFT_SCAN_MAX cold frames
+ * that belong to processes over the soft RSS limit, without moving
+ * the cold hand: the first frame not referenced since the hands
+ * last passed it whose owner holds more than its working set, or
+ * else the first one whose owner holds less.  Removes the victim
+ * from the frame table and returns it, or returns NULL if there is
+ * none.  FRAME_LOCK must be held. */
+static struct frame *
+get_soft_victim(void)
+{
+	struct frame *victim = NULL;
+	struct list_elem *e;
+	size_t scanned = 0;
+
+	if (soft_over_cnt == 0)
+		return NULL;
+
+	for (e = list_begin(&cold_frames);
+		 e != list_end(&cold_frames) && scanned < SOFT_SCAN_MAX;
+		 e = list_next(e), scanned++)
+	{
+		struct frame *f = list_entry(e, struct frame, clock_elem);
+		struct supplemental_page_table *owner = f->page->spt;
+
+		if (!frame_limit_evictable(f) || !over_soft_limit(owner) ||
+			frame_accessed(f))
+			continue;
+		if (owner->rss > owner->wss)
+		{
+			victim = f;
+			break;
+		}
+		if (victim == NULL)
+			victim = f;
+	}
+	if (victim != NULL)
+		frame_unlink(victim);
+	return victim;
+}
+
+/* Returns a victim among the frames of OWNER, a process at the hard
+ * RSS limit: the first unreferenced one on the cold clock, or else on
+ * the hot clock, or else the first one it may evict at all.  Removes
+ * the victim from the frame table.  Returns NULL if OWNER has no
+ * frame it may evict.  FRAME_LOCK must be held. */
+static struct frame *
+get_own_victim(struct supplemental_page_table *owner)
+{
+	struct list *lists[] = {&cold_frames, &hot_frames};
+	struct frame *victim = NULL;
+
+	for (int i = 0; i < 2; i++)
+	{
+		struct list_elem *e;
+
+		for (e = list_begin(lists[i]); e != list_end(lists[i]);
+			 e = list_next(e))
+		{
+			struct frame *f = list_entry(e, struct frame, clock_elem);
+
+			if (f->page->spt != owner || !frame_limit_evictable(f))
+				continue;
+			if (!frame_referenced(f))
+			{
+				frame_unlink(f);
+				return f;
+			}
+			if (victim == NULL)
+				victim = f;
+		}
+	}
+	if (victim != NULL)
+		frame_unlink(victim);
+	return victim;
+}
+
+/* Get the struct frame, that will be evicted.  Runs the cold hand:
+ * a referenced cold frame is promoted if it is in its test period
+ * and starts one otherwise, and the first unreferenced clean frame
+ * is the victim.  If a whole round finds only dirty ones, the first
+ * of those is taken.  The victim is removed from the frame table.
+ * Pinned frames and frames being written back to their files are
+ * passed over.  A frame's accessed and dirty bits are those of all
+ * the pages mapping it, so shared frames age like private ones.
+ * Frames of processes over the soft RSS limit go first.
+ * FRAME_LOCK must be held. */
+static struct frame *
+vm_get_victim(void)
+{
+	struct frame *dirty = NULL;
+	struct frame *victim;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	if (rss_soft_limit > 0 && (victim = get_soft_victim()) != NULL)
+	{
+		soft_evict_cnt++;
+		return victim;
+	}
+
+	/* Referenced frames are cleared as the hand passes them, so
+	 * the second round finds a victim unless they are touched again
+	 * meanwhile; the third takes one regardless. */
+	for (int round = 0; round < 3; round++)
+	{
+		size_t budget = cold_cnt;
+
+		if (cold_cnt == 0)
+			run_hot_hand();
+		if (cold_cnt == 0)
+			return NULL;
+
+		for (size_t i = 0; i < budget && cold_cnt > 0; i++)
+		{
+			struct frame *f = list_entry(list_front(&cold_frames),
+										 struct frame, clock_elem);
+
+			frame_unlink(f);
+			if (f->pin_cnt > 0 || f->writeback)
+			{
+				frame_push(f, FRAME_COLD);
+				continue;
+			}
+			if (round < 2 && frame_referenced(f))
+			{
+				if (f->test)
+				{
+					frame_push(f, FRAME_HOT);
+					balance_hot();
+				}
+				else
+				{
+					f->test = true;
+					frame_push(f, FRAME_COLD);
+				}
+				continue;
+			}
+
+			if (round < 2 && frame_dirty(f))
+			{
+				if (dirty == NULL)
+					dirty = f;
+				frame_push(f, FRAME_COLD);
+				continue;
+			}
+			return f;
+		}
+
+		if (dirty != NULL)
+		{
+			frame_unlink(dirty);
+			return dirty;
+		}
+	}
+	return NULL;
+}
+
+/* Takes up to MAX more victims for a swap cluster from the cold
+ * hand into CLUSTER and returns how many it took.  Only frames that
+ * would be evicted soon anyway qualify: unpinned, unreferenced
+ * anonymous ones.  Stops at the first frame that is not, without
+ * moving it.  FRAME_LOCK must be held. */
+static size_t
+gather_swap_cluster(struct frame *cluster[], size_t max)
 {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
-	/* TODO: 스레드별로 모든 supplemental_page_table 홀드를 삭제하고 수정된 모든 내용을 스토리지에 다시 씁니다. */
+	size_t cnt = 0;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	while (cnt < max && cold_cnt > 0)
+	{
+		struct frame *f = list_entry(list_front(&cold_frames), struct frame,
+									 clock_elem);
+		struct page *page = f->page;
+
+		if (f->pin_cnt > 0 || f->ref_cnt > 1 ||
+			VM_TYPE(page->operations->type) != VM_ANON || f->referenced ||
+			pml4_is_accessed(page->pml4, page->va))
+			break;
+		frame_unlink(f);
+		cluster[cnt++] = f;
+	}
+	return cnt;
+}
+
+/* Swaps out FRAME, an anonymous frame shared copy-on-write or merged
+ * by several pages and no longer in the frame table, after unmapping
+ * it from all of them.  Returns false, leaving it mapped as before,
+ * if swap is full.  FRAME_LOCK must be held; it is dropped while
+ * FRAME is written. */
+static bool
+frame_swap_out_shared(struct frame *frame)
+{
+	struct page *first = frame->page;
+	bool dirty = frame_dirty(frame);
+	struct list_elem *e;
+	bool ok;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	ASSERT(frame->thp == NULL);
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		pml4_clear_page(page->pml4, page->va);
+	}
+
+	frame->writeback = true;
+	lock_release(&frame_lock);
+	ok = anon_swap_out_shared(frame);
+	lock_acquire(&frame_lock);
+	frame->writeback = false;
+	cond_broadcast(&writeback_done, &frame_lock);
+
+	if (!ok)
+	{
+		/* Shared mappings are read-only. */
+		for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+			 e = list_next(e))
+		{
+			struct page *page = list_entry(e, struct page, frame_elem);
+
+			pml4_set_page(page->pml4, page->va, frame->kva, false);
+			pml4_set_dirty(page->pml4, page->va, dirty);
+		}
+		return false;
+	}
+
+	while (frame->ref_cnt > 0)
+		frame_remove_page(frame, frame->page);
+	ksm_forget(frame);
+	if (frame->test)
+		test_push(first);
+	return true;
+}
+
+/* Evict pages and return the frame of one of them.
+ * Return NULL on error.  If OWNER is not null, the victim is one of
+ * OWNER's pages, evicted alone.  A victim shared by several pages is
+ * unmapped from all of them and evicted alone.
+ *
+ * An anonymous victim is written to swap together with up to
+ * SWAP_CLUSTER - 1 more cold anonymous pages, in one disk command
+ * or into the compressed pool, and the extra frames go back to the
+ * user pool.  Page faults under memory pressure come in bursts, so
+ * the next few allocations then find a free page without
+ * evicting.
+ *
+ * The victims are chosen and taken out of the frame table under
+ * FRAME_LOCK, which is dropped while they are written.  Meanwhile
+ * they are marked as being written back, so that anyone loading,
+ * freeing or copying one of their pages waits for the eviction to
+ * finish. */
+static struct frame *
+vm_evict_frame(struct supplemental_page_table *owner)
+{
+	struct frame *cluster[SWAP_CLUSTER];
+	struct page *pages[SWAP_CLUSTER];
+	bool dirty[SWAP_CLUSTER];
+	bool written[SWAP_CLUSTER];
+	struct frame *result = NULL;
+	size_t cnt;
+
+	lock_acquire(&frame_lock);
+	if (owner != NULL)
+	{
+		cluster[0] = get_own_victim(owner);
+		if (cluster[0] != NULL)
+			hard_evict_cnt++;
+	}
+	else
+		cluster[0] = vm_get_victim();
+	if (cluster[0] == NULL)
+	{
+		lock_release(&frame_lock);
+		return NULL;
+	}
+	if (cluster[0]->inode != NULL)
+	{
+		text_cache_evict(cluster[0]);
+		lock_release(&frame_lock);
+		return cluster[0];
+	}
+	if (cluster[0]->ref_cnt > 1)
+	{
+		if (!frame_swap_out_shared(cluster[0]))
+		{
+			frame_push(cluster[0], FRAME_COLD);
+			cluster[0] = NULL;
+		}
+		lock_release(&frame_lock);
+		return cluster[0];
+	}
+	cnt = 1;
+	if (owner == NULL &&
+		VM_TYPE(cluster[0]->page->operations->type) == VM_ANON)
+		cnt += gather_swap_cluster(cluster + 1, SWAP_CLUSTER - 1);
+
+	/* Unmap first, so the owners cannot change the pages while they
+	 * are written out; a fault on one waits in claim_page(). */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		frame_split(cluster[i]);
+		pages[i] = cluster[i]->page;
+		dirty[i] = pml4_is_dirty(pages[i]->pml4, pages[i]->va);
+		pml4_clear_page(pages[i]->pml4, pages[i]->va);
+		cluster[i]->writeback = true;
+	}
+	lock_release(&frame_lock);
+
+	if (cnt > 1)
+		anon_swap_out_cluster(pages, cnt, written);
+	else
+		written[0] = swap_out(pages[0]);
+
+	lock_acquire(&frame_lock);
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct page *page = pages[i];
+
+		if (written[i])
+		{
+			frame_remove_page(cluster[i], page);
+			ksm_forget(cluster[i]);
+			if (cluster[i]->test)
+				test_push(page);
+		}
+		else
+		{
+			pml4_set_page(page->pml4, page->va, cluster[i]->kva,
+						  page->writable);
+			pml4_set_dirty(page->pml4, page->va, dirty[i]);
+			frame_push(cluster[i], FRAME_COLD);
+		}
+		cluster[i]->writeback = false;
+	}
+	cond_broadcast(&writeback_done, &frame_lock);
+	lock_release(&frame_lock);
+
+	/* Keep one frame for the caller. */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		if (!written[i])
+			continue;
+		if (result == NULL)
+			result = cluster[i];
+		else
+		{
+			palloc_free_page(cluster[i]->kva);
+			free(cluster[i]);
+		}
+	}
+	return result;
+}
+
+/* Returns a new frame for the user page at KVA, or NULL if out of
+ * memory. */
+static struct frame *
+frame_create(void *kva)
+{
+	struct frame *frame = malloc(sizeof *frame);
+
+	if (frame == NULL)
+		return NULL;
+	frame->kva = kva;
+	frame->page = NULL;
+	frame->ref_cnt = 0;
+	list_init(&frame->pages);
+	frame->inode = NULL;
+	frame->ksm_indexed = false;
+	frame->ksm_round = ksm_round - 1;
+	frame->state = FRAME_UNLISTED;
+	frame->pin_cnt = 0;
+	frame->writeback = false;
+	frame->referenced = false;
+	frame->thp = NULL;
+	return frame;
+}
+
+/* palloc() and get frame.  If there is no available page, evict a
+ * page and return its frame, unless EVICT is false.  Returns NULL
+ * only if the user pool is full and nothing could be evicted. */
+static struct frame *
+vm_get_frame(bool evict)
+{
+	struct frame *frame;
+	void *kva = palloc_get_page(PAL_USER);
+
+	if (kva == NULL)
+		return evict ? vm_evict_frame(NULL) : NULL;
+
+	frame = frame_create(kva);
+	if (frame == NULL)
+		palloc_free_page(kva);
+	return frame;
+}
+
+/* Waits until PAGE's frame, if it has one, is not being written
+ * back, to its file or by an eviction.  FRAME_LOCK must be held. */
+static void
+wait_writeback(struct page *page)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	while (page->frame != NULL && page->frame->writeback)
+		cond_wait(&writeback_done, &frame_lock);
+}
+
+/* Returns true if PAGE, which maps a file, is resident and dirty.
+ * FRAME_LOCK must be held. */
+static bool
+is_dirty_file_page(struct page *page)
+{
+	return page->frame != NULL && page->writable &&
+		   VM_TYPE(page->operations->type) == VM_FILE &&
+		   pml4_is_dirty(page->pml4, page->va);
+}
+
+/* Marks PAGE's frame as being written back and PAGE as clean, so
+ * that a write from now on makes it dirty again.  FRAME_LOCK must be
+ * held. */
+static void
+start_writeback(struct page *page)
+{
+	page->frame->writeback = true;
+	pml4_set_dirty(page->pml4, page->va, false);
+}
+
+/* If PAGE, a page mapping a file, is resident and dirty, starts
+ * writing it back and returns the kernel address of its contents,
+ * which stay put until vm_writeback_end().  Otherwise returns NULL.
+ * Waits for a write-back of PAGE already under way. */
+void *vm_writeback_begin(struct page *page)
+{
+	void *kva = NULL;
+
+	lock_acquire(&frame_lock);
+	wait_writeback(page);
+	if (is_dirty_file_page(page))
+	{
+		start_writeback(page);
+		kva = page->frame->kva;
+	}
+	lock_release(&frame_lock);
+	return kva;
+}
+
+/* Starts writing back up to MAX dirty resident pages mapping files,
+ * of any process, as vm_writeback_begin() does, and stores them in
+ * PAGES.  Returns how many it found. */
+size_t vm_writeback_gather(struct page *pages[], size_t max)
+{
+	struct list *lists[] = {&hot_frames, &cold_frames};
+	size_t cnt = 0;
+
+	lock_acquire(&frame_lock);
+	for (int i = 0; i < 2; i++)
+	{
+		struct list_elem *e;
+
+		for (e = list_begin(lists[i]); e != list_end(lists[i]) && cnt < max;
+			 e = list_next(e))
+		{
+			struct frame *f = list_entry(e, struct frame, clock_elem);
+
+			if (!f->writeback && is_dirty_file_page(f->page))
+			{
+				start_writeback(f->page);
+				pages[cnt++] = f->page;
+			}
+		}
+	}
+	lock_release(&frame_lock);
+	return cnt;
+}
+
+/* Finishes a write-back of PAGE started by vm_writeback_begin() or
+ * vm_writeback_gather(). */
+void vm_writeback_end(struct page *page)
+{
+	lock_acquire(&frame_lock);
+	page->frame->writeback = false;
+	cond_broadcast(&writeback_done, &frame_lock);
+	lock_release(&frame_lock);
+}
+
+/* If PAGE, a page mapping a file, is resident and dirty, unmaps it,
+ * takes its frame away from it and out of the frame table, and
+ * returns the frame's kernel address.  The caller then owns that
+ * page and must write it back and palloc_free_page() it.  Otherwise
+ * returns NULL. */
+void *vm_take_dirty_frame(struct page *page)
+{
+	struct frame *frame;
+	void *kva;
+
+	lock_acquire(&frame_lock);
+	wait_writeback(page);
+	frame = page->frame;
+	if (!is_dirty_file_page(page))
+	{
+		lock_release(&frame_lock);
+		return NULL;
+	}
+	test_remove(page);
+	pml4_clear_page(page->pml4, page->va);
+	frame_remove_page(frame, page);
+	frame_unlink(frame);
+	ksm_forget(frame);
+	lock_release(&frame_lock);
+
+	kva = frame->kva;
+	free(frame);
+	return kva;
+}
+
+/* Returns true if PAGE is an anonymous page that was never loaded
+ * and starts out zeroed. */
+static bool
+is_zero_fill_page(struct page *page)
+{
+	return VM_TYPE(page->operations->type) == VM_UNINIT &&
+		   VM_TYPE(page->uninit.type) == VM_ANON &&
+		   page->uninit.init == NULL;
+}
+
+/* Maps PAGE, which starts out zeroed, read-only to the zero page.
+ * Returns true if successful, false if out of memory. */
+static bool
+map_zero_page(struct page *page)
+{
+	if (!pml4_set_page(page->pml4, page->va, zero_page, false))
+		return false;
+	page->zero = true;
+	return true;
+}
+
+/* Unmaps PAGE from the zero page, if it is mapped to it. */
+static void
+unmap_zero_page(struct page *page)
+{
+	if (page->zero)
+	{
+		pml4_clear_page(page->pml4, page->va);
+		page->zero = false;
+	}
+}
+
+/* Unmaps PAGE and returns its frame, if it has one and PAGE was the
+ * last page sharing it, to the user pool.  Also forgets PAGE's test
+ * period, since it is going away or being loaded afresh. */
+void vm_free_frame(struct page *page)
+{
+	struct frame *frame;
+	bool last = false;
+
+	/* pml4_destroy() would free the zero page along with the
+	 * frames still mapped. */
+	unmap_zero_page(page);
+
+	lock_acquire(&frame_lock);
+	test_remove(page);
+	wait_writeback(page);
+	frame = page->frame;
+	if (frame != NULL)
+	{
+		/* Unmap before the frame can be freed by another sharer. */
+		frame_split(frame);
+		if (page->pml4 != NULL)
+			pml4_clear_page(page->pml4, page->va);
+		last = frame_remove_page(frame, page) == 0;
+		if (last)
+		{
+			frame_unlink(frame);
+			ksm_forget(frame);
+			if (frame->inode != NULL)
+				hash_delete(&text_cache, &frame->text_elem);
+			/* The merge scanner frees a frame it is hashing. */
+			if (frame->pin_cnt > 0)
+				last = false;
+		}
+	}
+	lock_release(&frame_lock);
+
+	if (last)
+	{
+		/* Within a batch of invalidations, a stale TLB entry may
+		 * still reach the frame until the batch ends. */
+		tlb_gather_free_page(page->pml4, frame->kva);
+		free(frame);
+	}
+}
+
+/* Returns true if a fault at ADDR with the stack pointer at RSP
+ * looks like an access to the stack, which may grow down to
+ * STACK_LIMIT.  PUSH faults 8 bytes below RSP. */
+bool vm_stack_access(const void *addr, const void *rsp)
+{
+	return (uint64_t)addr >= STACK_LIMIT && (uint64_t)addr < USER_STACK &&
+		   (uint64_t)addr + 8 >= (uint64_t)rsp;
+}
+
+/* Growing the stack. */
+static void
+vm_stack_growth(void *addr)
+{
+	void *upage = pg_round_down(addr);
+
+	if (vm_alloc_page(VM_ANON, upage, true))
+		vm_claim_page(upage);
+}
+
+/* Handle the fault on write_protected page.  PAGE is writable but
+ * mapped read-only because it shares its frame copy-on-write, or is
+ * mapped to the zero page.  The last page left sharing a frame just
+ * gets write access to it; any other gets a private copy. */
+static bool
+vm_handle_wp(struct page *page)
+{
+	struct frame *frame, *copy;
+	bool done;
+
+	if (!page->writable)
+		return false;
+	if (page->zero)
+		return vm_do_claim_page(page);
+
+	/* If PAGE was evicted meanwhile, the retried access faults it
+	 * back in, writable. */
+	lock_acquire(&frame_lock);
+	wait_writeback(page);
+	frame = page->frame;
+	done = frame == NULL || frame->ref_cnt == 1;
+	if (frame != NULL && frame->ref_cnt == 1)
+		pml4_set_writable(page->pml4, page->va, true);
+	lock_release(&frame_lock);
+	if (done)
+		return true;
+
+	/* Getting a frame may evict, which takes FRAME_LOCK, so do it
+	 * first and check again. */
+	copy = vm_get_frame(true);
+	if (copy == NULL)
+		return false;
+
+	lock_acquire(&frame_lock);
+	wait_writeback(page);
+	frame = page->frame;
+	done = frame == NULL || frame->ref_cnt == 1;
+	if (done)
+	{
+		if (frame != NULL)
+			pml4_set_writable(page->pml4, page->va, true);
+	}
+	else
+	{
+		memcpy(copy->kva, frame->kva, PGSIZE);
+		pml4_clear_page(page->pml4, page->va);
+		frame_remove_page(frame, page);
+		frame_add_page(copy, page);
+		/* The page table exists already, so this cannot fail. */
+		pml4_set_page(page->pml4, page->va, copy->kva, true);
+	}
+	lock_release(&frame_lock);
+
+	if (done)
+	{
+		palloc_free_page(copy->kva);
+		free(copy);
+	}
+	else
+		frame_table_insert(copy);
+	return true;
+}
+
+/* Fault-around.  After a fault loads a page from a file, the pages
+ * that follow it are loaded too, as long as they come from the
+ * following bytes of the same file, so that scanning a segment
+ * takes one fault per window rather than one per page.  The window
+ * doubles, up to FAULT_AROUND_MAX, each time a fault lands right
+ * after the previous window, and halves when one lands elsewhere.
+ * The window's frames are allocated as one block of free pages, so
+ * that a single read fills them all, and mapped afterwards; the
+ * window shrinks to fit the largest block it gets and never evicts.
+ * Pages loaded this way are mapped but not marked accessed, so if
+ * they go unused the cold hand reclaims them first. */
+#define FAULT_AROUND_MAX 16
+
+/* Returns the file PAGE, which page_file_pos() accepts, is read
+ * from. */
+static struct file *
+page_file(struct page *page)
+{
+	if (VM_TYPE(page->operations->type) == VM_UNINIT)
+		return ((struct file_segment *)page->uninit.aux)->file;
+	return page->file.file;
+}
+
+/* Turns PAGE, whose contents were just read into KVA by
+ * fault_around(), into the page it loads as, the way swap_in()
+ * would have, without reading them again. */
+static bool
+page_filled(struct page *page, void *kva)
+{
+	struct uninit_page *uninit = &page->uninit;
+	struct file_segment *seg = uninit->aux;
+
+	if (VM_TYPE(page->operations->type) != VM_UNINIT)
+		return true;
+	if (VM_TYPE(uninit->type) == VM_FILE)
+	{
+		file_backed_prepare(page);
+		return true;
+	}
+
+	/* A lazy anonymous page, whose loader would only have read SEG,
+	 * which it owns. */
+	if (!uninit->page_initializer(page, uninit->type, kva))
+		return false;
+	file_close(seg->file);
+	free(seg);
+	return true;
+}
+
+/* Loads PAGES[0..CNT), which come from consecutive bytes of one
+ * file, all but the last a whole page of them, with one read into
+ * a block of free frames.  Loads fewer if no block that large is
+ * free, or the hard limit leaves no room, and returns how many
+ * were loaded. */
+static size_t
+fault_around_load(struct page *pages[], size_t cnt)
+{
+	struct supplemental_page_table *spt = pages[0]->spt;
+	struct frame *frames[FAULT_AROUND_MAX];
+	struct frame pos;
+	size_t read_bytes = 0;
+	uint8_t *kva = NULL;
+	size_t n, i;
+
+	/* Up to the hard limit, which the window does not evict for. */
+	if (rss_hard_limit > 0)
+	{
+		size_t room = spt->rss < rss_hard_limit ? rss_hard_limit - spt->rss : 0;
+
+		if (cnt > room)
+			cnt = room;
+	}
+	for (n = cnt; n > 0; n /= 2)
+		if ((kva = palloc_get_multiple(PAL_USER, n)) != NULL)
+			break;
+	if (n == 0)
+		return 0;
+	for (i = 0; i < n; i++)
+	{
+		page_file_pos(pages[i], &pos);
+		read_bytes += pos.read_bytes;
+		frames[i] = frame_create(kva + i * PGSIZE);
+		if (frames[i] == NULL)
+			break;
+	}
+	/* Give back what a failed allocation leaves unused. */
+	if (i < n)
+	{
+		palloc_free_multiple(kva + i * PGSIZE, n - i);
+		read_bytes -= pos.read_bytes;
+		n = i;
+		if (n == 0)
+			return 0;
+	}
+
+	/* Like file_backed_swap_in(), see the file as mappings of it
+	 * left it. */
+	page_file_pos(pages[0], &pos);
+	file_writeback_sync(pos.inode);
+	if (file_read_at(page_file(pages[0]), kva, read_bytes, pos.ofs) !=
+		(off_t)read_bytes)
+	{
+		for (i = 0; i < n; i++)
+		{
+			palloc_free_page(frames[i]->kva);
+			free(frames[i]);
+		}
+		return 0;
+	}
+	memset(kva + read_bytes, 0, n * PGSIZE - read_bytes);
+
+	for (i = 0; i < n; i++)
+	{
+		struct page *page = pages[i];
+		struct frame *frame = frames[i];
+
+		lock_acquire(&frame_lock);
+		frame_add_page(frame, page);
+		lock_release(&frame_lock);
+		if (!page_filled(page, frame->kva) ||
+			!pml4_set_page(page->pml4, page->va, frame->kva, page->writable))
+		{
+			vm_free_frame(page);
+			break;
+		}
+		frame_table_insert(frame);
+	}
+	/* Free the frames of the pages not mapped. */
+	for (size_t j = i + 1; j < n; j++)
+	{
+		palloc_free_page(frames[j]->kva);
+		free(frames[j]);
+	}
+	return i;
+}
+
+/* Loads the pages after VA, which was just loaded from the file
+ * position in POS, into SPT as the window allows. */
+static void
+fault_around(struct supplemental_page_table *spt, void *va,
+			 const struct frame *pos)
+{
+	struct page *pages[FAULT_AROUND_MAX];
+	size_t cnt = 0;
+	off_t next_ofs = pos->ofs + pos->read_bytes;
+	size_t i;
+
+	if (va == spt->fault_next)
+		spt->fault_window = spt->fault_window == 0
+								? 1
+								: spt->fault_window * 2;
+	else
+		spt->fault_window /= 2;
+	if (spt->fault_window > FAULT_AROUND_MAX)
+		spt->fault_window = FAULT_AROUND_MAX;
+
+	/* Collect the pages to read, stopping at one that is resident
+	 * or in the text cache already, which is mapped instead, and
+	 * after one that ends short of a page, after which the file and
+	 * the frames no longer line up. */
+	for (i = 1; i <= spt->fault_window; i++)
+	{
+		void *next = (uint8_t *)va + i * PGSIZE;
+		struct page *page = spt_find_page(spt, next);
+		struct frame next_pos;
+
+		if (page == NULL || !page_file_pos(page, &next_pos) ||
+			next_pos.inode != pos->inode || next_pos.ofs != next_ofs)
+			break;
+		next_ofs += next_pos.read_bytes;
+		if (claim_page(page, CLAIM_CACHED))
+		{
+			if (cnt > 0)
+			{
+				i++;
+				break;
+			}
+			continue;
+		}
+		pages[cnt++] = page;
+		if (next_pos.read_bytes < PGSIZE)
+		{
+			i++;
+			break;
+		}
+	}
+
+	/* The window ends at the first page not loaded. */
+	if (cnt > 0)
+	{
+		size_t loaded = fault_around_load(pages, cnt);
+		size_t first = pg_no(pages[0]->va) - pg_no(va);
+
+		if (loaded < cnt)
+			i = first + loaded;
+	}
+	spt->fault_next = (uint8_t *)va + i * PGSIZE;
+}
+
+/* Frees the frames in FRAMES[0..CNT) and the 2 MB block at KVA they
+ * came from, which no page is mapped to. */
+static void
+thp_free_block(struct frame *frames[], size_t cnt, void *kva)
+{
+	for (size_t i = 0; i < cnt; i++)
+		free(frames[i]);
+	palloc_free_multiple(kva, LPG_PAGES);
+}
+
+/* Handles a write fault on PAGE, a zero-fill anonymous page of SPT,
+ * by mapping its whole 2 MB region with a huge page, if huge pages
+ * are enabled, the region is made up of writable zero-fill anonymous
+ * pages only, and a 2 MB block of frames is free.  Returns true if
+ * it did. */
+static bool
+thp_fault(struct supplemental_page_table *spt, struct page *page)
+{
+	uint8_t *base = lpg_round_down(page->va);
+	struct thp *thp;
+	uint8_t *kva;
+	size_t i;
+
+	if (!thp_enabled || !is_user_vaddr(base + LPGSIZE - 1) ||
+		(rss_hard_limit > 0 && spt->rss + LPG_PAGES > rss_hard_limit))
+		return false;
+	for (i = 0; i < LPG_PAGES; i++)
+	{
+		struct page *p = spt_find_page(spt, base + i * PGSIZE);
+
+		if (p == NULL || !p->writable || !is_zero_fill_page(p))
+			return false;
+	}
+
+	thp = malloc(sizeof *thp);
+	kva = palloc_get_large_page(PAL_USER);
+	if (thp == NULL || kva == NULL)
+	{
+		free(thp);
+		palloc_free_multiple(kva, LPG_PAGES);
+		return false;
+	}
+	for (i = 0; i < LPG_PAGES; i++)
+		if ((thp->frames[i] = frame_create(kva + i * PGSIZE)) == NULL)
+		{
+			thp_free_block(thp->frames, i, kva);
+			free(thp);
+			return false;
+		}
+
+	for (i = 0; i < LPG_PAGES; i++)
+		unmap_zero_page(spt_find_page(spt, base + i * PGSIZE));
+
+	lock_acquire(&frame_lock);
+	thp->va = base;
+	thp->pml4 = page->pml4;
+	thp->pt = pml4_replace_large_page(thp->pml4, base, kva, true);
+	if (thp->pt == NULL)
+	{
+		lock_release(&frame_lock);
+		thp_free_block(thp->frames, LPG_PAGES, kva);
+		free(thp);
+		return false;
+	}
+	for (i = 0; i < LPG_PAGES; i++)
+	{
+		struct page *p = spt_find_page(spt, base + i * PGSIZE);
+
+		/* Turns P into an anonymous page and zeroes its frame. */
+		swap_in(p, thp->frames[i]->kva);
+		frame_add_page(thp->frames[i], p);
+		thp->frames[i]->thp = thp;
+	}
+	thp_fault_cnt++;
+	lock_release(&frame_lock);
+
+	for (i = 0; i < LPG_PAGES; i++)
+		frame_table_insert(thp->frames[i]);
+	return true;
+}
+
+/* Collapses the 2 MB region at BASE in SPT into a huge page, if its
+ * pages are all writable anonymous pages, resident in unpinned
+ * frames of their own in the frame table, and a 2 MB block of frames
+ * is free.  Their contents are copied to the block, which takes
+ * their frames' place.  Returns true if it did.  FRAME_LOCK must be
+ * held, and SPT's lock, since SPT is another process's. */
+static bool
+thp_collapse(struct supplemental_page_table *spt, uint8_t *base)
+{
+	uint64_t *pml4 = NULL;
+	bool dirty = false;
+	struct thp *thp;
+	uint8_t *kva;
+	size_t i;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+	ASSERT(lock_held_by_current_thread(&spt->lock));
+
+	if (!is_user_vaddr(base + LPGSIZE - 1))
+		return false;
+	for (i = 0; i < LPG_PAGES; i++)
+	{
+		struct page *p = spt_find_page(spt, base + i * PGSIZE);
+		struct frame *f = p != NULL ? p->frame : NULL;
+
+		if (f == NULL || !p->writable ||
+			VM_TYPE(p->operations->type) != VM_ANON || f->ref_cnt != 1 ||
+			f->thp != NULL || f->pin_cnt > 0 || f->writeback ||
+			f->state == FRAME_UNLISTED || (pml4 != NULL && p->pml4 != pml4))
+			return false;
+		pml4 = p->pml4;
+	}
+
+	thp = malloc(sizeof *thp);
+	kva = palloc_get_large_page(PAL_USER);
+	if (thp == NULL || kva == NULL)
+	{
+		free(thp);
+		palloc_free_multiple(kva, LPG_PAGES);
+		return false;
+	}
+
+	/* Unmap first, so that the process cannot change a page after it
+	 * is copied; a fault on one waits for FRAME_LOCK. */
+	for (i = 0; i < LPG_PAGES; i++)
+	{
+		struct page *p = spt_find_page(spt, base + i * PGSIZE);
+
+		thp->frames[i] = p->frame;
+		if (pml4_is_dirty(pml4, p->va))
+			dirty = true;
+		if (pml4_is_accessed(pml4, p->va))
+			p->frame->referenced = true;
+		pml4_clear_page(pml4, p->va);
+	}
+	for (i = 0; i < LPG_PAGES; i++)
+	{
+		struct frame *f = thp->frames[i];
+
+		memcpy(kva + i * PGSIZE, f->kva, PGSIZE);
+		palloc_free_page(f->kva);
+		f->kva = kva + i * PGSIZE;
+		f->thp = thp;
+		ksm_forget(f);
+	}
+
+	/* The region's page table exists, so this cannot fail. */
+	thp->va = base;
+	thp->pml4 = pml4;
+	thp->pt = pml4_replace_large_page(pml4, base, kva, true);
+	ASSERT(thp->pt != NULL);
+	pml4_set_dirty(pml4, base, dirty);
+	pml4_set_accessed(pml4, base, false);
+	return true;
+}
+
+/* Collapses up to MAX fully resident 2 MB regions of anonymous
+ * memory, of any process, into huge pages.  Returns how many it
+ * collapsed. */
+size_t vm_thp_collapse(size_t max)
+{
+	struct list *lists[] = {&hot_frames, &cold_frames};
+	size_t cnt = 0;
+
+	lock_acquire(&frame_lock);
+	for (int i = 0; i < 2 && cnt < max; i++)
+	{
+		struct list_elem *e;
+
+		for (e = list_begin(lists[i]); e != list_end(lists[i]) && cnt < max;
+			 e = list_next(e))
+		{
+			struct frame *f = list_entry(e, struct frame, clock_elem);
+			struct page *page = f->page;
+			struct supplemental_page_table *spt = page->spt;
+			bool collapsed;
+
+			if (f->thp != NULL || lpg_ofs(page->va) != 0 ||
+				VM_TYPE(page->operations->type) != VM_ANON)
+				continue;
+
+			/* PAGE, and so its process, stays alive while the frame
+			 * lock is held; SPT's lock keeps the rest of the region
+			 * from being freed while it is looked at. */
+			lock_acquire(&spt->lock);
+			collapsed = thp_collapse(spt, page->va);
+			lock_release(&spt->lock);
+			if (collapsed)
+				cnt++;
+		}
+	}
+	lock_release(&frame_lock);
+	return cnt;
+}
+
+/* Stores the number of huge pages mapped on fault in *FAULTS and of
+ * those split in *SPLITS. */
+void vm_thp_stats(size_t *faults, size_t *splits)
+{
+	*faults = thp_fault_cnt;
+	*splits = thp_split_cnt;
+}
+
+/* Return true on success */
+bool vm_try_handle_fault(struct intr_frame *f, void *addr,
+						 bool user, bool write, bool not_present)
+{
+	struct thread *t = thread_current();
+	struct supplemental_page_table *spt = &t->spt;
+	struct page *page;
+	struct frame pos;
+
+	if (addr == NULL || !is_user_vaddr(addr))
+		return false;
+
+	ws_sample(spt);
+	page = spt_find_page(spt, addr);
+
+	/* A protection fault: only copy-on-write pages are handled. */
+	if (!not_present)
+		return page != NULL && write && vm_handle_wp(page);
+
+	if (page == NULL)
+	{
+		/* In the kernel, F holds kernel state, so use the user stack
+		 * pointer saved on system call entry. */
+		void *rsp = user ? (void *)f->rsp : t->user_rsp;
+
+		if (!vm_stack_access(addr, rsp))
+			return false;
+		vm_stack_growth(addr);
+		return spt_find_page(spt, addr) != NULL;
+	}
+
+	if (write && !page->writable)
+		return false;
+
+	if (is_zero_fill_page(page))
+	{
+		if (write ? thp_fault(spt, page) : map_zero_page(page))
+			return true;
+	}
+
+	/* A lazy page's segment is consumed by loading it, so note
+	 * where it comes from first. */
+	if (!page_file_pos(page, &pos))
+		return vm_do_claim_page(page);
+	if (!vm_do_claim_page(page))
+		return false;
+	fault_around(spt, page->va, &pos);
+	return true;
+}
+
+/* Free the page.
+ * DO NOT MODIFY THIS FUNCTION. */
+void vm_dealloc_page(struct page *page)
+{
+	destroy(page);
+	free(page);
+}
+
+/* Claim the page that allocate on VA. */
+bool vm_claim_page(void *va)
+{
+	struct page *page = spt_find_page(&thread_current()->spt, va);
+
+	if (page == NULL)
+		return false;
+
+	return vm_do_claim_page(page);
+}
+
+/* Makes PAGE resident, if it is not, and maps it, as FLAGS say. */
+static bool
+claim_page(struct page *page, enum claim_flags flags)
+{
+	bool pin = (flags & CLAIM_PIN) != 0;
+	bool text = is_text_page(page);
+	struct frame *frame;
+
+	/* Set up a lazy text page to be read from its file now, so that
+	 * it can be mapped to a cached frame instead. */
+	if (text && VM_TYPE(page->operations->type) == VM_UNINIT)
+		file_backed_prepare(page);
+
+	/* If PAGE is being evicted, wait until it is written out.  If
+	 * the eviction failed, it is mapped again and there is nothing
+	 * to do. */
+	lock_acquire(&frame_lock);
+	wait_writeback(page);
+	frame = page->frame;
+	if (frame == NULL && text)
+		frame = text_cache_map(page);
+	if (frame != NULL && pin)
+		frame->pin_cnt++;
+	lock_release(&frame_lock);
+	if (frame != NULL)
+		return true;
+	if (flags & CLAIM_CACHED)
+		return false;
+
+	unmap_zero_page(page);
+
+	/* At the hard limit, a process pays for each page it loads with
+	 * one of its own. */
+	frame = NULL;
+	if (at_hard_limit(page->spt))
+	{
+		if (flags & CLAIM_NO_EVICT)
+			return false;
+		frame = vm_evict_frame(page->spt);
+	}
+	if (frame == NULL)
+		frame = vm_get_frame((flags & CLAIM_NO_EVICT) == 0);
+	if (frame == NULL)
+		return false;
+
+	/* Set links */
+	lock_acquire(&frame_lock);
+	frame_add_page(frame, page);
+	lock_release(&frame_lock);
+
+	/* Fill the frame before mapping it, so the process never sees
+	 * a partly loaded page. */
+	if (!swap_in(page, frame->kva) ||
+		!pml4_set_page(page->pml4, page->va, frame->kva, page->writable))
+	{
+		vm_free_frame(page);
+		return false;
+	}
+	/* The frame is not in the frame table yet, so no one else
+	 * looks at it. */
+	frame->pin_cnt = pin ? 1 : 0;
+	frame_table_insert(frame);
+	return true;
+}
+
+/* Maps the page at VA if it is a VM_TEXT page whose contents are in
+ * the text cache, so that it never faults.  Returns true if the
+ * page is now mapped. */
+bool vm_claim_cached_page(void *va)
+{
+	struct page *page = spt_find_page(&thread_current()->spt, va);
+
+	return page != NULL && claim_page(page, CLAIM_CACHED);
+}
+
+/* Claim the PAGE and set up the mmu. */
+static bool
+vm_do_claim_page(struct page *page)
+{
+	return claim_page(page, 0);
+}
+
+/* Makes PAGE resident and keeps it so until vm_unpin_page(). */
+static bool
+vm_pin_page(struct page *page)
+{
+	return claim_page(page, CLAIM_PIN);
+}
+
+/* Drops a pin vm_pin_page() took on PAGE's frame.  Several
+ * processes may pin a shared frame at once, so it can be evicted
+ * again only once all of them have unpinned it. */
+static void
+vm_unpin_page(struct page *page)
+{
+	lock_acquire(&frame_lock);
+	if (page->frame != NULL)
+	{
+		ASSERT(page->frame->pin_cnt > 0);
+		page->frame->pin_cnt--;
+	}
+	lock_release(&frame_lock);
+}
+
+/* Pins the page of the current process holding the user address
+ * ADDR, growing the stack into it if need be.  If WRITE, the page
+ * must be writable, and it gets a private frame if it shares one
+ * copy-on-write, so that the kernel can write to it without
+ * faulting. */
+static bool
+pin_user_page(const void *addr, bool write)
+{
+	struct thread *t = thread_current();
+	struct page *page = spt_find_page(&t->spt, (void *)addr);
+
+	if (page == NULL)
+	{
+		if (!vm_stack_access(addr, t->user_rsp))
+			return false;
+		vm_stack_growth((void *)addr);
+		page = spt_find_page(&t->spt, (void *)addr);
+		if (page == NULL)
+			return false;
+	}
+	if (write && !page->writable)
+		return false;
+
+	/* Pinned frames are not merged, but one may be shared already;
+	 * copying it takes a new frame, so copy unpinned and retry. */
+	for (;;)
+	{
+		bool shared;
+
+		if (!vm_pin_page(page))
+			return false;
+		if (!write)
+			return true;
+		lock_acquire(&frame_lock);
+		shared = page->frame != NULL && page->frame->ref_cnt > 1;
+		lock_release(&frame_lock);
+		if (!shared)
+			return true;
+		vm_unpin_page(page);
+		if (!vm_handle_wp(page))
+			return false;
+	}
+}
+
+/* Loads and pins the pages of the current process under the SIZE
+ * bytes at user address BUFFER, so that the kernel can access them
+ * without page faults, say while it holds file system locks.  WRITE
+ * says whether the kernel will write to the buffer.  Returns false,
+ * with nothing pinned, if part of the buffer is not mapped, or not
+ * writable for WRITE.  Undo with vm_unpin_buffer(). */
+bool vm_pin_buffer(const void *buffer, size_t size, bool write)
+{
+	const uint8_t *end = (const uint8_t *)buffer + size;
+	const uint8_t *addr;
+
+	if (size == 0)
+		return true;
+	if (end < (const uint8_t *)buffer || !is_user_vaddr(buffer) ||
+		!is_user_vaddr(end - 1))
+		return false;
+
+	for (addr = buffer; addr < end;
+		 addr = (const uint8_t *)pg_round_down(addr) + PGSIZE)
+		if (!pin_user_page(addr, write))
+		{
+			vm_unpin_buffer(buffer, addr - (const uint8_t *)buffer);
+			return false;
+		}
+	return true;
+}
+
+/* Unpins the pages pinned by vm_pin_buffer(BUFFER, SIZE, ...). */
+void vm_unpin_buffer(const void *buffer, size_t size)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	const uint8_t *end = (const uint8_t *)buffer + size;
+	const uint8_t *addr;
+
+	for (addr = buffer; addr < end;
+		 addr = (const uint8_t *)pg_round_down(addr) + PGSIZE)
+	{
+		struct page *page = spt_find_page(spt, (void *)addr);
+
+		if (page != NULL)
+			vm_unpin_page(page);
+	}
+}
+
+/* Initialize new supplemental page table */
+/* 새 보조 페이지 테이블 초기화 */
+void supplemental_page_table_init(struct supplemental_page_table *spt)
+{
+	lock_init(&spt->lock);
+	spt->root = NULL;
+	spt->page_cnt = 0;
+	spt->fault_next = NULL;
+	spt->fault_window = 0;
+	spt->rss = 0;
+	spt->wss = 0;
+	spt->ws_sampled = timer_ticks();
+}
+
+/* Adds a page to the current thread's SPT that shares SRC's frame
+ * copy-on-write, loading SRC first if it is in swap.  Both mappings
+ * become read-only, and the first write through either one gets it
+ * a private copy; see vm_handle_wp(). */
+static bool
+share_page(struct page *src)
+{
+	struct thread *t = thread_current();
+	struct page *dst;
+	bool ok;
+
+	if (!vm_pin_page(src))
+		return false;
+
+	dst = malloc(sizeof *dst);
+	if (dst == NULL)
+		goto fail;
+	*dst = *src;
+	dst->pml4 = t->pml4;
+	dst->spt = &t->spt;
+	dst->frame = NULL;
+	dst->in_test = false;
+	dst->ws_ref = false;
+	dst->anon.swap_slot = SWAP_SLOT_NONE;
+	dst->anon.zswap = NULL;
+	if (!spt_insert_page(&t->spt, dst))
+	{
+		free(dst);
+		goto fail;
+	}
+
+	lock_acquire(&frame_lock);
+	frame_split(src->frame);
+	ok = pml4_set_page(dst->pml4, dst->va, src->frame->kva, false);
+	if (ok)
+	{
+		frame_add_page(src->frame, dst);
+		pml4_set_writable(src->pml4, src->va, false);
+	}
+	lock_release(&frame_lock);
+	vm_unpin_page(src);
+	return ok;
+
+fail:
+	vm_unpin_page(src);
+	return false;
+}
+
+/* Returns true if FRAME may be merged: it is in the frame table,
+ * unpinned, not part of a huge page, and holds anonymous memory.  FRAME_LOCK must be held. */
+static bool
+ksm_mergeable(struct frame *frame)
+{
+	return frame->state != FRAME_UNLISTED && frame->pin_cnt == 0 &&
+		   frame->thp == NULL &&
+		   VM_TYPE(frame->page->operations->type) == VM_ANON;
+}
+
+/* Makes every mapping of FRAME read-only. */
+static void
+frame_write_protect(struct frame *frame)
+{
+	struct list_elem *e;
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages);
+		 e = list_next(e))
+	{
+		struct page *page = list_entry(e, struct page, frame_elem);
+
+		pml4_set_writable(page->pml4, page->va, false);
+	}
+}
+
+/* Undoes frame_write_protect(FRAME): a frame mapped by a single page
+ * is writable if the page is.  A shared frame stays read-only, as
+ * copy-on-write needs. */
+static void
+frame_write_unprotect(struct frame *frame)
+{
+	if (frame->ref_cnt == 1 && frame->page->writable)
+		pml4_set_writable(frame->page->pml4, frame->page->va, true);
+}
+
+/* Moves every page mapped to FROM over to TO, read-only, and frees
+ * FROM.  FRAME_LOCK must be held. */
+static void
+ksm_merge(struct frame *from, struct frame *to)
+{
+	while (from->ref_cnt > 0)
+	{
+		struct page *page = from->page;
+
+		pml4_clear_page(page->pml4, page->va);
+		frame_remove_page(from, page);
+		frame_add_page(to, page);
+		/* The page table exists already, so this cannot fail. */
+		pml4_set_page(page->pml4, page->va, to->kva, false);
+	}
+	frame_unlink(from);
+	ksm_forget(from);
+	palloc_free_page(from->kva);
+	free(from);
+}
+
+/* Pins up to MAX frames not yet scanned in this round into BATCH,
+ * marking them scanned, and returns how many it found.  FRAME_LOCK
+ * must be held. */
+static size_t
+ksm_gather(struct frame *batch[], size_t max)
+{
+	struct list *lists[] = {&hot_frames, &cold_frames};
+	size_t cnt = 0;
+
+	for (int i = 0; i < 2; i++)
+	{
+		struct list_elem *e;
+
+		for (e = list_begin(lists[i]); e != list_end(lists[i]) && cnt < max;
+			 e = list_next(e))
+		{
+			struct frame *f = list_entry(e, struct frame, clock_elem);
+
+			if (f->ksm_round == ksm_round || !ksm_mergeable(f))
+				continue;
+			f->ksm_round = ksm_round;
+			f->pin_cnt++;
+			batch[cnt++] = f;
+		}
+	}
+	return cnt;
+}
+
+/* Unpins FRAME, pinned by ksm_gather() and hashed to HASH since, and
+ * indexes it by HASH, or merges it into an indexed frame with the
+ * same contents.  Frees FRAME if its last page went away meanwhile.
+ * Returns true if FRAME was merged away.  FRAME_LOCK must be held. */
+static bool
+ksm_scan_frame(struct frame *frame, uint64_t hash)
+{
+	struct frame *other;
+
+	ASSERT(frame->pin_cnt > 0);
+
+	frame->pin_cnt--;
+	if (frame->ref_cnt == 0)
+	{
+		palloc_free_page(frame->kva);
+		free(frame);
+		return false;
+	}
+	if (!ksm_mergeable(frame) ||
+		(frame->ksm_indexed && frame->ksm_hash == hash))
+		return false;
+
+	ksm_forget(frame);
+	other = phash_find(&ksm_index, hash);
+	if (other == NULL)
+	{
+		frame->ksm_hash = hash;
+		frame->ksm_indexed = phash_insert(&ksm_index, hash, frame);
+		return false;
+	}
+	if (!ksm_mergeable(other))
+		return false;
+
+	frame_write_protect(frame);
+	frame_write_protect(other);
+	if (memcmp(frame->kva, other->kva, PGSIZE) != 0)
+	{
+		frame_write_unprotect(frame);
+		frame_write_unprotect(other);
+		return false;
+	}
+	ksm_merge(frame, other);
+	return true;
+}
+
+/* Scans up to CNT anonymous frames for merging, going on from where
+ * the previous call stopped, and returns how many it scanned.  Adds
+ * the number of frames merged away, and so freed, to *MERGED. */
+size_t vm_ksm_scan(size_t cnt, size_t *merged)
+{
+	struct frame *batch[KSM_BATCH];
+	uint64_t hashes[KSM_BATCH];
+	size_t scanned = 0;
+	bool wrapped = false;
+
+	while (scanned < cnt)
+	{
+		size_t max = cnt - scanned < KSM_BATCH ? cnt - scanned : KSM_BATCH;
+		size_t n;
+
+		lock_acquire(&frame_lock);
+		n = ksm_gather(batch, max);
+		if (n == 0 && !wrapped)
+		{
+			/* Once every frame has been scanned, start over. */
+			ksm_round++;
+			wrapped = true;
+			n = ksm_gather(batch, max);
+		}
+		lock_release(&frame_lock);
+		if (n == 0)
+			break;
+
+		/* Hash without FRAME_LOCK, so that page faults do not wait
+		 * for it.  The pins keep the frames' contents in place. */
+		for (size_t i = 0; i < n; i++)
+			hashes[i] = hash_bytes(batch[i]->kva, PGSIZE);
+
+		lock_acquire(&frame_lock);
+		for (size_t i = 0; i < n; i++)
+			if (ksm_scan_frame(batch[i], hashes[i]))
+				(*merged)++;
+		lock_release(&frame_lock);
+		scanned += n;
+	}
+	return scanned;
+}
+
+/* Adds a lazy page of TYPE at VA to the current thread's SPT that
+ * is loaded by INIT from its own copy of SEG. */
+static bool
+copy_segment(enum vm_type type, void *va, bool writable,
+			 vm_initializer *init, const struct file_segment *seg)
+{
+	struct file_segment *dup = malloc(sizeof *dup);
+
+	if (dup == NULL)
+		return false;
+	*dup = *seg;
+	dup->file = file_reopen(seg->file);
+	if (dup->file == NULL ||
+		!vm_alloc_page_with_initializer(type, va, writable, init, dup))
+	{
+		file_close(dup->file);
+		free(dup);
+		return false;
+	}
+	return true;
+}
+
+/* Adds a copy of SRC to the current thread's SPT.  Pages that were
+ * never loaded stay lazy, with their own copy of the segment to
+ * load from.  Anonymous pages, including ones now in swap, are
+ * shared copy-on-write, and text pages through the text cache;
+ * pages of mapped files are copied now. */
+static bool
+copy_page(struct page *src, void *aux UNUSED)
+{
+	struct file_segment seg;
+	struct page *dst;
+
+	if (VM_TYPE(src->operations->type) == VM_UNINIT)
+	{
+		if (src->uninit.aux == NULL)
+			return vm_alloc_page_with_initializer(src->uninit.type, src->va,
+												  src->writable,
+												  src->uninit.init, NULL);
+		return copy_segment(src->uninit.type, src->va, src->writable,
+							src->uninit.init, src->uninit.aux);
+	}
+
+	if (VM_TYPE(src->operations->type) == VM_ANON)
+		return share_page(src);
+
+	/* The copy of a file page maps the same part of the file. */
+	seg.file = src->file.file;
+	seg.ofs = src->file.ofs;
+	seg.read_bytes = src->file.read_bytes;
+	seg.map = src->file.map;
+	if (src->file.text)
+	{
+		if (!copy_segment(VM_FILE | VM_TEXT, src->va, false, NULL, &seg))
+			return false;
+		vm_claim_cached_page(src->va);
+		return true;
+	}
+
+	/* A page of a mapped file starts out with SRC's contents,
+	 * whether they were written back yet or not. */
+	if (!copy_segment(VM_FILE, src->va, src->writable, NULL, &seg))
+		return false;
+	dst = spt_find_page(&thread_current()->spt, src->va);
+
+	/* SRC may be in swap.  Pin both pages, so that loading one
+	 * cannot evict the other and neither is evicted mid-copy. */
+	if (!vm_pin_page(dst))
+		return false;
+	if (!vm_pin_page(src))
+	{
+		vm_unpin_page(dst);
+		return false;
+	}
+	memcpy(dst->frame->kva, src->frame->kva, PGSIZE);
+	vm_unpin_page(src);
+	vm_unpin_page(dst);
+	return true;
+}
+
+/* Copy supplemental page table from src to dst */
+bool supplemental_page_table_copy(struct supplemental_page_table *dst,
+								  struct supplemental_page_table *src)
+{
+	ASSERT(dst == &thread_current()->spt);
+
+	return spt_for_each(src, NULL, (void *)KERN_BASE, copy_page, NULL);
+}
+
+/* Frees NODE, a level-LEVEL node of an SPT, with everything below
+ * it. */
+static void
+spt_destroy_node(void **node, int level)
+{
+	for (size_t i = 0; i < SPT_FANOUT; i++)
+	{
+		if (node[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+			vm_dealloc_page(node[i]);
+		else
+			spt_destroy_node(node[i], level + 1);
+	}
+	palloc_free_page(node);
+}
+
+/* Free the resource hold by the supplemental page table */
+/* 보조 페이지 테이블로 리소스 보유를 해제합니다. */
+void supplemental_page_table_kill(struct supplemental_page_table *spt)
+{
+	void **root;
+
+	/* Unlink the tree, so that no lookup under SPT's lock can reach
+	 * it once it is freed. */
+	lock_acquire(&spt->lock);
+	root = spt->root;
+	spt->root = NULL;
+	spt->page_cnt = 0;
+	lock_release(&spt->lock);
+
+	/* Leave SPT empty and reusable, as process_exec() needs.  The
+	 * pages still count towards its RSS until they are freed. */
+	spt->fault_next = NULL;
+	spt->fault_window = 0;
+	spt->wss = 0;
+	spt->ws_sampled = timer_ticks();
+	if (root != NULL)
+		spt_destroy_node(root, 0);
+}
+
+/* Prints statistics about the RSS limits, if there are any. */
+void vm_print_stats(void)
+{
+	if (rss_soft_limit == 0 && rss_hard_limit == 0)
+		return;
+
+	printf("RSS limits: %zu pages evicted over the soft limit, "
+		   "%zu at the hard limit\n",
+		   soft_evict_cnt, hard_evict_cnt);
 }
@@ -0,0 +1,307 @@
+/* zswap.c: Compressed in-memory pool in front of the swap disk. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* Anonymous pages on their way to swap are first offered to the
+ * compressed pool.  A page that compresses to at most half a page is
+ * kept here, and swapping it back in is a decompression instead of
+ * a disk read.  The pool may grow to zswap_max_percent of the kernel
+ * pool, which its slabs come from; past that, the pages stored
+ * longest ago are written back to the swap disk to make room.  The
+ * share is capped at ZSWAP_MAX_PERCENT, so that page tables, threads
+ * and the like always find room.  The slabs cannot come from the
+ * user pool: pages are stored while evicting, when it is full.
+ *
+ * Compressed pages live in slabs: single kernel pages cut into
+ * equal objects.  Size class K holds K objects of PGSIZE / K bytes,
+ * for K from 2 to SLAB_OBJS, and a compressed page goes into the
+ * class with the smallest objects it fits in.  A slab's free objects
+ * are tracked in one 64-bit mask, and a slab is returned to the
+ * kernel pool as soon as it is empty. */
+
+/* Most objects in one slab, and so the largest size class. */
+#define SLAB_OBJS 64
+
+/* Pages that do not compress to this size are not kept.  Anything
+ * larger would take a whole slab page by itself. */
+#define MAX_COMPRESSED (PGSIZE / 2)
+
+/* A slab: one kernel page cut into OBJ_CNT objects. */
+struct slab {
+	struct list_elem elem;      /* In its class's partial list, if it has
+	                               a free object. */
+	uint8_t *base;              /* The page. */
+	uint64_t free_map;          /* Bit I set if object I is free. */
+	size_t obj_cnt;             /* Objects in the slab: its size class. */
+};
+
+/* A page held in the pool. */
+struct zswap_entry {
+	struct page *page;          /* Page the data belongs to. */
+	struct slab *slab;          /* Slab holding the data. */
+	unsigned obj;               /* Object index in SLAB. */
+	size_t len;                 /* Compressed length. */
+	struct list_elem lru_elem;  /* In lru, oldest first. */
+};
+
+unsigned zswap_max_percent;
+
+static struct lock zswap_lock;  /* Protects everything below, and the
+                                   zswap member of every anon_page. */
+static struct list partial[SLAB_OBJS + 1]; /* Slabs with a free object,
+                                              by size class. */
+static struct list lru;         /* Entries, least recently stored first. */
+static size_t pool_pages;       /* Slab pages allocated. */
+static size_t max_pages;        /* Limit on pool_pages. */
+static void *lz_work;           /* Compressor scratch memory. */
+static uint8_t *buffer;         /* One page for compressed output and
+                                   write-back. */
+static zswap_writeback_func *writeback;
+
+/* Statistics. */
+static size_t store_cnt, reject_cnt, writeback_cnt;
+static size_t hit_cnt, miss_cnt;
+static unsigned long long bytes_in, bytes_out;
+
+/* Sets up the pool, which will write pages back with WB. */
+void
+zswap_init (zswap_writeback_func *wb) {
+	writeback = wb;
+	lock_init (&zswap_lock);
+	list_init (&lru);
+	for (size_t k = 0; k <= SLAB_OBJS; k++)
+		list_init (&partial[k]);
+
+	if (zswap_max_percent == 0)
+		return;
+	if (zswap_max_percent > ZSWAP_MAX_PERCENT)
+		zswap_max_percent = ZSWAP_MAX_PERCENT;
+	max_pages = palloc_kernel_page_cnt () * zswap_max_percent / 100;
+	lz_work = palloc_get_multiple (PAL_ASSERT,
+			DIV_ROUND_UP (LZ_WORK_SIZE, PGSIZE));
+	buffer = palloc_get_page (PAL_ASSERT);
+}
+
+/* Returns the object size of size class K. */
+static size_t
+obj_size (size_t k) {
+	return PGSIZE / k / 8 * 8;
+}
+
+/* Returns the free map of an empty slab of size class K. */
+static uint64_t
+empty_map (size_t k) {
+	return k == 64 ? UINT64_MAX : ((uint64_t) 1 << k) - 1;
+}
+
+/* Allocates an object of at least LEN bytes.  Stores its slab and
+ * index into *SLABP and *OBJP and returns its address, or returns
+ * NULL if memory is short. */
+static void *
+obj_alloc (size_t len, struct slab **slabp, unsigned *objp) {
+	size_t k = PGSIZE / ROUND_UP (len, 8);
+	struct slab *s;
+	unsigned obj;
+
+	if (k > SLAB_OBJS)
+		k = SLAB_OBJS;
+	ASSERT (k >= 2 && obj_size (k) >= len);
+
+	if (list_empty (&partial[k])) {
+		s = malloc (sizeof *s);
+		if (s == NULL)
+			return NULL;
+		s->base = palloc_get_page (0);
+		if (s->base == NULL) {
+			free (s);
+			return NULL;
+		}
+		s->obj_cnt = k;
+		s->free_map = empty_map (k);
+		list_push_front (&partial[k], &s->elem);
+		pool_pages++;
+	}
+
+	s = list_entry (list_front (&partial[k]), struct slab, elem);
+	obj = __builtin_ctzll (s->free_map);
+	s->free_map &= ~((uint64_t) 1 << obj);
+	if (s->free_map == 0)
+		list_remove (&s->elem);
+
+	*slabp = s;
+	*objp = obj;
+	return s->base + obj * obj_size (k);
+}
+
+/* Frees object OBJ of slab S, and S itself if it becomes empty. */
+static void
+obj_free (struct slab *s, unsigned obj) {
+	ASSERT ((s->free_map & ((uint64_t) 1 << obj)) == 0);
+
+	if (s->free_map == 0)
+		list_push_front (&partial[s->obj_cnt], &s->elem);
+	s->free_map |= (uint64_t) 1 << obj;
+
+	if (s->free_map == empty_map (s->obj_cnt)) {
+		list_remove (&s->elem);
+		palloc_free_page (s->base);
+		free (s);
+		pool_pages--;
+	}
+}
+
+/* Returns the compressed data of E. */
+static void *
+entry_data (struct zswap_entry *e) {
+	return e->slab->base + e->obj * obj_size (e->slab->obj_cnt);
+}
+
+/* Decompresses E into the page at KVA. */
+static void
+entry_load (struct zswap_entry *e, void *kva) {
+	if (!lz_decompress (entry_data (e), e->len, kva, PGSIZE))
+		PANIC ("zswap: corrupt entry for page %p", e->page->va);
+}
+
+/* Removes E from the pool and from its page, and frees it. */
+static void
+entry_free (struct zswap_entry *e) {
+	list_remove (&e->lru_elem);
+	obj_free (e->slab, e->obj);
+	e->page->anon.zswap = NULL;
+	free (e);
+}
+
+/* Writes the entry stored longest ago back to the swap disk and
+ * drops it.  Returns false if there is none or the swap disk is
+ * full. */
+static bool
+writeback_oldest (void) {
+	struct zswap_entry *e;
+
+	if (list_empty (&lru))
+		return false;
+	e = list_entry (list_front (&lru), struct zswap_entry, lru_elem);
+	entry_load (e, buffer);
+	if (!writeback (e->page, buffer))
+		return false;
+	entry_free (e);
+	writeback_cnt++;
+	return true;
+}
+
+/* Tries to keep PAGE, whose contents are at KVA, in the pool
+ * instead of on disk.  Returns true if it was stored, false if the
+ * pool is disabled, full, or PAGE does not compress well enough. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *e;
+	void *data;
+	size_t len;
+
+	if (zswap_max_percent == 0)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	ASSERT (page->anon.zswap == NULL);
+
+	/* Make room first, while BUFFER is free for write-back. */
+	while (pool_pages >= max_pages && writeback_oldest ())
+		continue;
+	if (pool_pages >= max_pages)
+		goto reject;
+
+	len = lz_compress (kva, PGSIZE, buffer, MAX_COMPRESSED, lz_work);
+	if (len == 0)
+		goto reject;
+
+	e = malloc (sizeof *e);
+	if (e == NULL)
+		goto reject;
+	data = obj_alloc (len, &e->slab, &e->obj);
+	if (data == NULL) {
+		free (e);
+		goto reject;
+	}
+	memcpy (data, buffer, len);
+	e->page = page;
+	e->len = len;
+	list_push_back (&lru, &e->lru_elem);
+	page->anon.zswap = e;
+
+	store_cnt++;
+	bytes_in += PGSIZE;
+	bytes_out += len;
+	lock_release (&zswap_lock);
+	return true;
+
+reject:
+	reject_cnt++;
+	lock_release (&zswap_lock);
+	return false;
+}
+
+/* If PAGE is in the pool, decompresses it into KVA, drops it from
+ * the pool, and returns true.  Otherwise returns false, and PAGE is
+ * on the swap disk. */
+bool
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *e;
+
+	if (zswap_max_percent == 0)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	e = page->anon.zswap;
+	if (e != NULL) {
+		entry_load (e, kva);
+		entry_free (e);
+		hit_cnt++;
+	} else
+		miss_cnt++;
+	lock_release (&zswap_lock);
+	return e != NULL;
+}
+
+/* Drops PAGE from the pool, if it is there. */
+void
+zswap_invalidate (struct page *page) {
+	if (zswap_max_percent == 0)
+		return;
+
+	lock_acquire (&zswap_lock);
+	if (page->anon.zswap != NULL)
+		entry_free (page->anon.zswap);
+	lock_release (&zswap_lock);
+}
+
+/* Prints compressed pool statistics. */
+void
+zswap_print_stats (void) {
+	unsigned long long ratio, loads;
+
+	if (zswap_max_percent == 0)
+		return;
+
+	ratio = bytes_out > 0 ? bytes_in * 100 / bytes_out : 0;
+	loads = hit_cnt + miss_cnt;
+	printf ("zswap: %zu stores, %zu rejected, %zu written back, "
+			"%zu of %zu pool pages\n",
+			store_cnt, reject_cnt, writeback_cnt, pool_pages, max_pages);
+	printf ("zswap: compression ratio %llu.%02llu, "
+			"hit rate %llu%% (%zu of %llu swap-ins)\n",
+			ratio / 100, ratio % 100,
+			loads > 0 ? hit_cnt * 100ULL / loads : 0, hit_cnt, loads);
+}